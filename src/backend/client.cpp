@@ -1,7 +1,11 @@
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <deque>
+#include <map>
 #include <boost/asio.hpp>
-#include <boost/asio/spawn.hpp>
 #include <backend/client.h>
 #include <backend/ipc.h>
 
@@ -11,72 +15,143 @@ namespace slipway
     {
         class client_impl : public client
         {
+            struct pending
+            {
+                callback handler;
+                std::unique_ptr<boost::asio::steady_timer> timer;
+            };
+
             boost::asio::io_context m_io;
+            boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_work;
             slipway::ipc::socket m_socket;
-
-            void execute(const std::function<void(boost::asio::yield_context yield)>& function) noexcept(false)
+            slipway::codec m_format = slipway::json;
+            boost::asio::streambuf m_input;
+            boost::asio::streambuf m_output;
+            std::deque<message> m_queue;
+            std::map<uint32_t, pending> m_requests;
+            uint32_t m_last = 0;
+            bool m_writing = false;
+            bool m_legacy = false;
+            std::thread m_thread;
+
+            void complete(uint32_t id, const message& response, const std::string& error)
             {
-                m_io.restart();
+                auto iter = m_requests.find(id);
+                if (iter == m_requests.end())
+                    return;
 
-                boost::asio::spawn(m_io, [&](boost::asio::yield_context yield)
-                {
-                    static constexpr const int REQUEST_TIMEOUT = 10;
+                auto handler = std::move(iter->second.handler);
+                m_requests.erase(iter);
 
-                    boost::asio::deadline_timer timer(m_io);
+                handler(response, error);
+                write();
+            }
 
-                    timer.expires_from_now(boost::posix_time::seconds(REQUEST_TIMEOUT));
-                    timer.async_wait([&](const boost::system::error_code& error)
-                    {
-                        if(error)
-                        {
-                            if (error == boost::asio::error::operation_aborted)
-                                return;
-
-                            std::cerr << error.message() << std::endl;
-                        }
-
-                        try
-                        {
-                            m_socket.close();
-                        }
-                        catch (const std::exception &ex)
-                        {
-                            std::cerr << ex.what() << std::endl;
-                        }
-                    });
+            void abort(const std::string& error)
+            {
+                boost::system::error_code ec;
+                m_socket.close(ec);
 
-                    function(yield);
+                m_queue.clear();
 
-                    boost::system::error_code ec;
-                    timer.cancel(ec);
-                }, boost::asio::detached);
+                auto requests = std::move(m_requests);
+                m_requests.clear();
 
-                m_io.run();
+                for (auto& item : requests)
+                    item.second.handler(message::make(message::naught), error);
             }
 
-            template<class result = std::string>
-            result perform(const message& request)
+            void write()
             {
-                message response;
+                if (m_writing || m_queue.empty())
+                    return;
 
-                execute([&](boost::asio::yield_context yield)
+                // the json speaking server reads the next request only after the response to the previous one
+                if (m_format == slipway::json && m_requests.size() > m_queue.size())
+                    return;
+
+                auto request = std::move(m_queue.front());
+                m_queue.pop_front();
+
+                try
+                {
+                    push_message(m_output, request, m_format);
+                }
+                catch (const std::exception& ex)
                 {
-                    boost::asio::streambuf buffer;
-                    push_message(buffer, request);
+                    return complete(request.id, message::make(message::naught), ex.what());
+                }
 
-                    boost::system::error_code ec;
-                    boost::asio::async_write(m_socket, buffer, yield[ec]);
+                m_writing = true;
+                boost::asio::async_write(m_socket, m_output, [this](const boost::system::error_code& ec, size_t)
+                {
+                    m_writing = false;
 
                     if (ec)
-                        throw pipe_error("Can't write to socket due the error \'" + ec.message() + "\'");
+                        return abort("Can't write to socket due the error \'" + ec.message() + "\'");
 
-                    boost::asio::async_read_until(m_socket, buffer, '\n', yield[ec]);
+                    write();
+                });
+            }
 
+            void read()
+            {
+                boost::asio::async_read_until(m_socket, m_input, frame(m_format), [this](const boost::system::error_code& ec, size_t)
+                {
                     if (ec)
-                        throw pipe_error("Can't read from socket due the error \'" + ec.message() + "\'");
+                        return abort("Can't read from socket due the error \'" + ec.message() + "\'");
+
+                    message response;
+                    try
+                    {
+                        pull_message(m_input, response, m_format);
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        return abort(ex.what());
+                    }
+
+                    if (response.action == message::accord && response.payload.index() == 6 && std::get<uint32_t>(response.payload) > 0)
+                        m_format = slipway::binary;
+
+                    // the legacy server doesn't echo the request id, but it answers in order
+                    uint32_t id = response.id == 0 && !m_requests.empty() ? m_requests.begin()->first : response.id;
 
-                    pull_message(buffer, response);
+                    complete(id, response, "");
+                    read();
                 });
+            }
+
+            // the legacy server takes the request with an unknown payload for the one without it, that is for all services
+            bool unsupported(const message& request) const noexcept(true)
+            {
+                return m_legacy && (request.payload.index() == 7 || request.payload.index() == 8);
+            }
+
+            template<class result = std::string>
+            result perform(const message& request)
+            {
+                static constexpr const std::chrono::seconds REQUEST_TIMEOUT(10);
+
+                // the response is completed on the client thread, so waiting for it there would never end
+                if (std::this_thread::get_id() == m_thread.get_id())
+                    throw task_error("The blocking request can't be made from the client callback");
+
+                if (unsupported(request))
+                    throw task_error("The server doesn't support the request for the selected services");
+
+                std::promise<message> promise;
+                auto future = promise.get_future();
+
+                submit(request, REQUEST_TIMEOUT, [&promise](const message& response, const std::string& error)
+                {
+                    if (error.empty())
+                        promise.set_value(response);
+                    else
+                        promise.set_exception(std::make_exception_ptr(pipe_error(error)));
+                });
+
+                message response = future.get();
 
                 if (!response.ok())
                     throw task_error("The server reported the error \'" + std::get<std::string>(response.payload) + "\'");
@@ -87,44 +162,112 @@ namespace slipway
         public:
 
             client_impl(const std::filesystem::path& home)
-                : m_socket(m_io)
+                : m_work(boost::asio::make_work_guard(m_io))
+                , m_socket(m_io)
+                , m_input(max_message_size)
             {
-                execute([&](boost::asio::yield_context yield)
-                {
-                    static constexpr const size_t MAX_ATTEMPTS = 5;
+                static constexpr const size_t MAX_ATTEMPTS = 5;
 
-                    auto server = slipway::ipc::make_endpoint(home);
+                auto server = slipway::ipc::make_endpoint(home);
 
-                    boost::system::error_code ec;
-                    for(size_t i = 0; i < MAX_ATTEMPTS; ++i)
-                    {
+                boost::system::error_code ec;
+                for(size_t i = 0; i < MAX_ATTEMPTS; ++i)
+                {
 #ifdef WIN32
-                        if (ec.value() == ERROR_FILE_NOT_FOUND || ec.value() == ERROR_PIPE_BUSY)
+                    if (ec.value() == ERROR_FILE_NOT_FOUND || ec.value() == ERROR_PIPE_BUSY)
 #else
-                        if (ec.value() == boost::system::errc::no_such_file_or_directory || ec.value() == boost::system::errc::connection_refused)
+                    if (ec.value() == boost::system::errc::no_such_file_or_directory || ec.value() == boost::system::errc::connection_refused)
 #endif
-                        {
-                            boost::asio::deadline_timer timer(m_io);
-                            timer.expires_from_now(boost::posix_time::milliseconds(i * 500));
-                            timer.async_wait(yield[ec]);
-
-                            if (ec)
-                                break;
-                        }
- 
-                        slipway::ipc::connect_server(m_socket, server, ec);
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(i * 500));
+                    }
+
+                    slipway::ipc::connect_server(m_socket, server, ec);
 #ifdef WIN32
-                        if (ec.value() != ERROR_FILE_NOT_FOUND && ec.value() != ERROR_PIPE_BUSY)
+                    if (ec.value() != ERROR_FILE_NOT_FOUND && ec.value() != ERROR_PIPE_BUSY)
 #else
-                        if (ec.value() != boost::system::errc::no_such_file_or_directory && ec.value() != boost::system::errc::connection_refused)
+                    if (ec.value() != boost::system::errc::no_such_file_or_directory && ec.value() != boost::system::errc::connection_refused)
 #endif
-                        {
-                            break;
-                        }
+                    {
+                        break;
                     }
+                }
 
-                    if (ec)
-                        throw pipe_error("Can't connect to " + server.path() + " due the error \'" + ec.message() + "\'");
+                if (ec)
+                    throw pipe_error("Can't connect to " + server.path() + " due the error \'" + ec.message() + "\'");
+
+                m_thread = std::thread([this]()
+                {
+                    read();
+                    m_io.run();
+                });
+
+                try
+                {
+                    perform<uint32_t>(message::make(message::accord, message_version));
+                }
+                catch (const task_error&)
+                {
+                    // the server doesn't know the accord and talks json only
+                    m_legacy = true;
+                }
+                catch (...)
+                {
+                    boost::asio::post(m_io, [this]()
+                    {
+                        abort("The client is closed");
+                        m_work.reset();
+                    });
+
+                    m_thread.join();
+                    throw;
+                }
+            }
+
+            ~client_impl()
+            {
+                boost::asio::post(m_io, [this]()
+                {
+                    abort("The client is closed");
+                    m_work.reset();
+                });
+
+                if (m_thread.joinable())
+                    m_thread.join();
+            }
+
+            void submit(const message& request, const std::chrono::milliseconds& deadline, const callback& handler) noexcept(true) override
+            {
+                boost::asio::post(m_io, [this, req = request, deadline, handler]() mutable
+                {
+                    if (unsupported(req))
+                        return handler(message::make(message::naught), "The server doesn't support the request for the selected services");
+
+                    if (++m_last == 0)
+                        ++m_last;
+
+                    uint32_t id = m_last;
+                    req.id = id;
+
+                    auto timer = std::make_unique<boost::asio::steady_timer>(m_io, deadline);
+                    timer->async_wait([this, id](const boost::system::error_code& ec)
+                    {
+                        if (ec)
+                            return;
+
+                        m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [id](const message& item) { return item.id == id; }), m_queue.end());
+
+                        // the late response of the json speaking server can't be told from the next one
+                        if (m_format == slipway::json)
+                            abort("The request is timed out");
+                        else
+                            complete(id, message::make(message::naught), "The request is timed out");
+                    });
+
+                    m_requests.emplace(id, pending { handler, std::move(timer) });
+                    m_queue.push_back(req);
+
+                    write();
                 });
             }
 
@@ -177,6 +320,41 @@ namespace slipway
             {
                 result = perform<slipway::report>(message::make(message::review, service));
             }
+
+            void unplug(const std::vector<handle>& services, std::vector<slipway::health>& result) noexcept(false) override
+            {
+                result = perform<std::vector<slipway::health>>(message::make(message::unplug, services));
+            }
+
+            void engage(const std::vector<handle>& services, std::vector<slipway::health>& result) noexcept(false) override
+            {
+                result = perform<std::vector<slipway::health>>(message::make(message::engage, services));
+            }
+
+            void adjust(const std::vector<handle>& services, std::vector<slipway::health>& result) noexcept(false) override
+            {
+                result = perform<std::vector<slipway::health>>(message::make(message::adjust, services));
+            }
+
+            void status(const std::vector<handle>& services, std::vector<slipway::health>& result) noexcept(false) override
+            {
+                result = perform<std::vector<slipway::health>>(message::make(message::status, services));
+            }
+
+            void review(const std::vector<handle>& services, std::vector<slipway::report>& result) noexcept(false) override
+            {
+                result = perform<std::vector<slipway::report>>(message::make(message::review, services));
+            }
+
+            void status(const query& filter, slipway::digest& result) noexcept(false) override
+            {
+                result = perform<slipway::digest>(message::make(message::status, filter));
+            }
+
+            void review(const query& filter, slipway::digest& result) noexcept(false) override
+            {
+                result = perform<slipway::digest>(message::make(message::review, filter));
+            }
         };
     }
 
@@ -3,13 +3,21 @@
 #include <backend/message.h>
 #include <string>
 #include <memory>
+#include <chrono>
+#include <functional>
 #include <filesystem>
 
 namespace slipway
 {
     struct client
     {
+        // the error is set if the request was not delivered or the response was not received in time
+        using callback = std::function<void(const slipway::message& response, const std::string& error)>;
+
         virtual ~client() {}
+        // send the request without waiting for the response, the callback is invoked from the client thread
+        // and the blocking methods throw the 'task_error' if they are called from it
+        virtual void submit(const slipway::message& request, const std::chrono::milliseconds& deadline, const callback& handler) noexcept(true) = 0;
         // suspend all services
         virtual void unplug() noexcept(false) = 0;
         // reset all services according to its configurations and drop removed ones
@@ -30,6 +38,16 @@ namespace slipway
         virtual void status(const slipway::handle& service, slipway::health& result) noexcept(false) = 0;
         // get a report on the specified service
         virtual void review(const slipway::handle& service, slipway::report& result) noexcept(false) = 0;
+        // the handle with empty service name selects all services of the pier, the result is reported per each selected service,
+        // these and the filtered requests throw the task_error if the server predates the accord
+        virtual void unplug(const std::vector<slipway::handle>& services, std::vector<slipway::health>& result) noexcept(false) = 0;
+        virtual void engage(const std::vector<slipway::handle>& services, std::vector<slipway::health>& result) noexcept(false) = 0;
+        virtual void adjust(const std::vector<slipway::handle>& services, std::vector<slipway::health>& result) noexcept(false) = 0;
+        virtual void status(const std::vector<slipway::handle>& services, std::vector<slipway::health>& result) noexcept(false) = 0;
+        virtual void review(const std::vector<slipway::handle>& services, std::vector<slipway::report>& result) noexcept(false) = 0;
+        // get a page of the filtered status or reports, the tunnels are not reported by the status query
+        virtual void status(const slipway::query& filter, slipway::digest& result) noexcept(false) = 0;
+        virtual void review(const slipway::query& filter, slipway::digest& result) noexcept(false) = 0;
     };
 
     // home - path to the webpier context directory
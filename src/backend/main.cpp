@@ -1,4 +1,5 @@
 #include <backend/server.h>
+#include <store/context.h>
 #include <store/utils.h>
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
@@ -31,6 +32,24 @@ int main(int argc, char* argv[])
             return 3;
         }
 
+        if (argc > 2)
+        {
+            std::string command = argv[2];
+            if (command != "--pack" && command != "--unpack")
+            {
+                std::cerr << "wrong command argument" << std::endl;
+                return 7;
+            }
+
+            auto context = webpier::open_context(home);
+            if (command == "--pack")
+                context->pack();
+            else
+                context->unpack();
+
+            return 0;
+        }
+
         std::filesystem::path locker = home / slipway_lock_file_name;
 
         if (!std::filesystem::exists(locker))
@@ -45,6 +64,13 @@ int main(int argc, char* argv[])
             return 4;
         }
 
+#ifdef BOOST_ASIO_HAS_IO_URING
+        if (!webpier::verify_io_uring())
+        {
+            std::cerr << "io_uring is not supported" << std::endl;
+            return 6;
+        }
+#endif
         boost::asio::io_context io;
 
         auto server = slipway::create_backend(io, home.string());
@@ -80,119 +80,625 @@ namespace slipway
             }
             return obj;
         }
-    }
 
-    void push_message(std::streambuf& buffer, const slipway::message& msg) noexcept(true)
-    {
-        boost::property_tree::ptree doc;
+        boost::property_tree::ptree convert_query(const slipway::query& obj) noexcept(true)
+        {
+            boost::property_tree::ptree doc;
+            doc.put("pier", webpier::locale_to_utf8(obj.pier));
+            doc.put("side", obj.side);
+            doc.put("states", obj.states);
+            doc.put("fields", obj.fields);
+            doc.put_child("after", convert_handle(obj.after));
+            doc.put("limit", obj.limit);
+            doc.put("since", obj.since);
+            return doc;
+        }
 
-        doc.put("action", msg.action);
-        switch(msg.payload.index())
+        slipway::query convert_query(const boost::property_tree::ptree& doc) noexcept(false)
         {
-            case 0:
+            slipway::query obj;
+            obj.pier = webpier::utf8_to_locale(doc.get<std::string>("pier", ""));
+            obj.side = static_cast<query::scope>(doc.get<int>("side", query::anyone));
+            obj.states = static_cast<uint8_t>(doc.get<int>("states", 0));
+            obj.fields = static_cast<uint8_t>(doc.get<int>("fields", query::state | query::message | query::tunnels));
+            if (doc.count("after"))
+                obj.after = convert_handle(doc.get_child("after"));
+            obj.limit = doc.get<uint32_t>("limit", 0);
+            obj.since = doc.get<uint64_t>("since", 0);
+            return obj;
+        }
+
+        boost::property_tree::ptree convert_digest(const slipway::digest& obj) noexcept(true)
+        {
+            boost::property_tree::ptree doc;
+            doc.put("stamp", obj.stamp);
+            doc.put("changed", obj.changed);
+            doc.put("more", obj.more);
+            doc.put("fields", obj.fields);
+
+            boost::property_tree::ptree items;
+            for (const auto& item : obj.items)
             {
-                const auto& error = std::get<std::string>(msg.payload);
-                if (!error.empty())
-                    doc.put("error", webpier::locale_to_utf8(error));
-                break;
+                auto entry = convert_report(item);
+                if ((obj.fields & query::state) == 0)
+                    entry.erase("state");
+                if ((obj.fields & query::message) == 0)
+                    entry.erase("message");
+                if ((obj.fields & query::tunnels) == 0)
+                    entry.erase("tunnels");
+                items.push_back(std::make_pair("", entry));
             }
-            case 1:
+            doc.put_child("items", items);
+            return doc;
+        }
+
+        slipway::digest convert_digest(const boost::property_tree::ptree& doc) noexcept(false)
+        {
+            slipway::digest obj;
+            obj.stamp = doc.get<uint64_t>("stamp");
+            obj.changed = doc.get<bool>("changed");
+            obj.more = doc.get<bool>("more");
+            obj.fields = static_cast<uint8_t>(doc.get<int>("fields"));
+
+            boost::property_tree::ptree items;
+            for (const auto& item : doc.get_child("items", items))
             {
-                doc.put_child("handle", convert_handle(std::get<slipway::handle>(msg.payload)));
-                break;
+                slipway::report report;
+                report.pier = webpier::utf8_to_locale(item.second.get<std::string>("pier"));
+                report.service = webpier::utf8_to_locale(item.second.get<std::string>("service"));
+                report.state = static_cast<health::status>(item.second.get<int>("state", health::asleep));
+                report.message = webpier::utf8_to_locale(item.second.get<std::string>("message", ""));
+
+                boost::property_tree::ptree tunnels;
+                for (auto& link : item.second.get_child("tunnels", tunnels))
+                    report.tunnels.emplace_back(report::tunnel { webpier::utf8_to_locale(link.second.get<std::string>("pier")), link.second.get<uint32_t>("pid") });
+
+                obj.items.emplace_back(std::move(report));
             }
-            case 2:
+            return obj;
+        }
+
+        class writer
+        {
+            std::string m_data;
+
+        public:
+
+            writer()
             {
-                doc.put_child("health", convert_health(std::get<slipway::health>(msg.payload)));
-                break;
+                m_data.append(4, '\0');
             }
-            case 3:
+
+            void put(uint8_t value) noexcept(true)
             {
-                doc.put_child("report", convert_report(std::get<slipway::report>(msg.payload)));
-                break;
+                m_data.push_back(static_cast<char>(value));
             }
-            case 4:
+
+            void put(uint32_t value) noexcept(true)
             {
-                boost::property_tree::ptree health;
-                for (const auto& item : std::get<std::vector<slipway::health>>(msg.payload))
-                    health.push_back(std::make_pair("", convert_health(item)));
-                doc.put_child("health", health);
-                break;
+                for (size_t i = 0; i < 4; ++i)
+                    m_data.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
             }
-            case 5:
+
+            void put(uint64_t value) noexcept(true)
             {
-                boost::property_tree::ptree report;
-                for (const auto& item : std::get<std::vector<slipway::report>>(msg.payload))
-                    report.push_back(std::make_pair("", convert_report(item)));
-                doc.put_child("report", report);
-                break;
+                put(static_cast<uint32_t>(value));
+                put(static_cast<uint32_t>(value >> 32));
             }
-            default:
-                break;
-        }
 
-        std::ostringstream ss;
-        boost::property_tree::write_json(ss, doc, false);
+            void put(const std::string& value) noexcept(true)
+            {
+                std::string data = webpier::locale_to_utf8(value);
+                put(static_cast<uint32_t>(data.size()));
+                m_data.append(data);
+            }
 
-        std::string data = ss.str();
+            void put(const slipway::handle& obj) noexcept(true)
+            {
+                put(obj.pier);
+                put(obj.service);
+            }
 
-        if (data.empty() || data.back() != '\n') {
-            data += '\n';
-        }
+            void put(const slipway::health& obj) noexcept(true)
+            {
+                put(static_cast<const slipway::handle&>(obj));
+                put(static_cast<uint8_t>(obj.state));
+                put(obj.message);
+            }
 
-        std::ostream stream(&buffer);
-        stream << data;
-        stream.flush();
-    }
+            void put(const slipway::report& obj) noexcept(true)
+            {
+                put(static_cast<const slipway::health&>(obj));
+                put(static_cast<uint32_t>(obj.tunnels.size()));
+                for (const auto& link : obj.tunnels)
+                {
+                    put(link.pier);
+                    put(link.pid);
+                }
+            }
 
-    void pull_message(std::streambuf& buffer, slipway::message& msg) noexcept(false)
-    {
-        std::istream stream(&buffer);
-        boost::property_tree::ptree doc;
-        boost::property_tree::read_json(stream, doc);
+            void put(const slipway::query& obj) noexcept(true)
+            {
+                put(obj.pier);
+                put(static_cast<uint8_t>(obj.side));
+                put(obj.states);
+                put(obj.fields);
+                put(obj.after);
+                put(obj.limit);
+                put(obj.since);
+            }
+
+            void put(const slipway::digest& obj) noexcept(true)
+            {
+                put(obj.stamp);
+                put(static_cast<uint8_t>((obj.changed ? 1 : 0) | (obj.more ? 2 : 0)));
+                put(obj.fields);
+                put(static_cast<uint32_t>(obj.items.size()));
+                for (const auto& item : obj.items)
+                {
+                    put(static_cast<const slipway::handle&>(item));
+                    if (obj.fields & query::state)
+                        put(static_cast<uint8_t>(item.state));
+                    if (obj.fields & query::message)
+                        put(item.message);
+                    if (obj.fields & query::tunnels)
+                    {
+                        put(static_cast<uint32_t>(item.tunnels.size()));
+                        for (const auto& link : item.tunnels)
+                        {
+                            put(link.pier);
+                            put(link.pid);
+                        }
+                    }
+                }
+            }
+
+            template<class item>
+            void put(const std::vector<item>& list) noexcept(true)
+            {
+                put(static_cast<uint32_t>(list.size()));
+                for (const auto& obj : list)
+                    put(obj);
+            }
 
-        msg.action = static_cast<message::command>(doc.get<int>("action"));
-        msg.payload = {};
+            void flush(std::streambuf& buffer) noexcept(false)
+            {
+                if (m_data.size() - 4 > max_message_size)
+                    throw pipe_error("Too large message");
+
+                uint32_t size = static_cast<uint32_t>(m_data.size() - 4);
+                for (size_t i = 0; i < 4; ++i)
+                    m_data[i] = static_cast<char>((size >> (i * 8)) & 0xff);
+
+                if (buffer.sputn(m_data.data(), m_data.size()) != static_cast<std::streamsize>(m_data.size()))
+                    throw pipe_error("Can't write message");
+            }
+        };
 
-        if (doc.count("error"))
+        class reader
         {
-            msg.payload = webpier::utf8_to_locale(doc.get<std::string>("error"));
-        }
-        else if (doc.count("handle"))
+            std::string m_data;
+            size_t m_pos = 0;
+
+            const char* take(size_t size) noexcept(false)
+            {
+                if (m_data.size() - m_pos < size)
+                    throw pipe_error("Malformed message");
+
+                const char* ptr = m_data.data() + m_pos;
+                m_pos += size;
+                return ptr;
+            }
+
+        public:
+
+            reader(std::streambuf& buffer) noexcept(false)
+            {
+                char head[4];
+                if (buffer.sgetn(head, 4) != 4)
+                    throw pipe_error("Malformed message");
+
+                size_t size = 0;
+                for (size_t i = 0; i < 4; ++i)
+                    size |= static_cast<size_t>(static_cast<uint8_t>(head[i])) << (i * 8);
+
+                if (size > max_message_size)
+                    throw pipe_error("Too large message");
+
+                m_data.resize(size);
+                if (static_cast<size_t>(buffer.sgetn(m_data.data(), size)) != size)
+                    throw pipe_error("Malformed message");
+            }
+
+            void get(uint8_t& value) noexcept(false)
+            {
+                value = static_cast<uint8_t>(*take(1));
+            }
+
+            void get(uint32_t& value) noexcept(false)
+            {
+                const char* ptr = take(4);
+
+                value = 0;
+                for (size_t i = 0; i < 4; ++i)
+                    value |= static_cast<uint32_t>(static_cast<uint8_t>(ptr[i])) << (i * 8);
+            }
+
+            void get(uint64_t& value) noexcept(false)
+            {
+                uint32_t low, high;
+                get(low);
+                get(high);
+                value = static_cast<uint64_t>(high) << 32 | low;
+            }
+
+            void get(std::string& value) noexcept(false)
+            {
+                uint32_t size;
+                get(size);
+                const char* ptr = take(size);
+                value = webpier::utf8_to_locale(std::string(ptr, size));
+            }
+
+            void get(slipway::handle& obj) noexcept(false)
+            {
+                get(obj.pier);
+                get(obj.service);
+            }
+
+            void get(slipway::health& obj) noexcept(false)
+            {
+                get(static_cast<slipway::handle&>(obj));
+                uint8_t state;
+                get(state);
+                obj.state = static_cast<health::status>(state);
+                get(obj.message);
+            }
+
+            void get(slipway::report& obj) noexcept(false)
+            {
+                get(static_cast<slipway::health&>(obj));
+                get(obj.tunnels);
+            }
+
+            void get(slipway::report::tunnel& obj) noexcept(false)
+            {
+                get(obj.pier);
+                get(obj.pid);
+            }
+
+            void get(slipway::query& obj) noexcept(false)
+            {
+                uint8_t side;
+                get(obj.pier);
+                get(side);
+                get(obj.states);
+                get(obj.fields);
+                get(obj.after);
+                get(obj.limit);
+                get(obj.since);
+                obj.side = static_cast<query::scope>(side);
+            }
+
+            void get(slipway::digest& obj) noexcept(false)
+            {
+                uint8_t flags;
+                get(obj.stamp);
+                get(flags);
+                get(obj.fields);
+                obj.changed = flags & 1;
+                obj.more = flags & 2;
+
+                uint32_t size;
+                get(size);
+                obj.items.clear();
+                for (uint32_t i = 0; i < size; ++i)
+                {
+                    slipway::report item;
+                    item.state = health::asleep;
+                    get(static_cast<slipway::handle&>(item));
+                    if (obj.fields & query::state)
+                    {
+                        uint8_t state;
+                        get(state);
+                        item.state = static_cast<health::status>(state);
+                    }
+                    if (obj.fields & query::message)
+                        get(item.message);
+                    if (obj.fields & query::tunnels)
+                        get(item.tunnels);
+                    obj.items.emplace_back(std::move(item));
+                }
+            }
+
+            template<class item>
+            void get(std::vector<item>& list) noexcept(false)
+            {
+                uint32_t size;
+                get(size);
+                list.clear();
+                for (uint32_t i = 0; i < size; ++i)
+                {
+                    item obj;
+                    get(obj);
+                    list.emplace_back(std::move(obj));
+                }
+            }
+        };
+
+        void push_binary(std::streambuf& buffer, const slipway::message& msg) noexcept(false)
         {
-            msg.payload = convert_handle(doc.get_child("handle"));
+            writer out;
+            out.put(static_cast<uint8_t>(msg.action));
+            out.put(msg.id);
+            out.put(static_cast<uint8_t>(msg.payload.index()));
+
+            std::visit([&out](const auto& value) { out.put(value); }, msg.payload);
+
+            out.flush(buffer);
         }
-        else if (doc.count("health"))
+
+        void pull_binary(std::streambuf& buffer, slipway::message& msg) noexcept(false)
         {
-            boost::property_tree::ptree health;
-            health = doc.get_child("health", health);
-            if (health.count("") || health.empty())
+            reader in(buffer);
+
+            uint8_t action, index;
+            in.get(action);
+            in.get(msg.id);
+            in.get(index);
+
+            msg.action = static_cast<message::command>(action);
+
+            switch (index)
             {
-                std::vector<slipway::health> list;
-                for (const auto& item : health)
-                    list.emplace_back(convert_health(item.second));
-                msg.payload = list;
+                case 0:
+                {
+                    std::string error;
+                    in.get(error);
+                    msg.payload = error;
+                    break;
+                }
+                case 1:
+                {
+                    slipway::handle obj;
+                    in.get(obj);
+                    msg.payload = obj;
+                    break;
+                }
+                case 2:
+                {
+                    slipway::health obj;
+                    in.get(obj);
+                    msg.payload = obj;
+                    break;
+                }
+                case 3:
+                {
+                    slipway::report obj;
+                    in.get(obj);
+                    msg.payload = obj;
+                    break;
+                }
+                case 4:
+                {
+                    std::vector<slipway::health> list;
+                    in.get(list);
+                    msg.payload = list;
+                    break;
+                }
+                case 5:
+                {
+                    std::vector<slipway::report> list;
+                    in.get(list);
+                    msg.payload = list;
+                    break;
+                }
+                case 6:
+                {
+                    uint32_t version;
+                    in.get(version);
+                    msg.payload = version;
+                    break;
+                }
+                case 7:
+                {
+                    std::vector<slipway::handle> list;
+                    in.get(list);
+                    msg.payload = list;
+                    break;
+                }
+                case 8:
+                {
+                    slipway::query obj;
+                    in.get(obj);
+                    msg.payload = obj;
+                    break;
+                }
+                case 9:
+                {
+                    slipway::digest obj;
+                    in.get(obj);
+                    msg.payload = obj;
+                    break;
+                }
+                default:
+                    throw pipe_error("Malformed message");
             }
-            else
+        }
+
+        void push_json(std::streambuf& buffer, const slipway::message& msg) noexcept(false)
+        {
+            boost::property_tree::ptree doc;
+
+            doc.put("action", msg.action);
+            if (msg.id)
+                doc.put("id", msg.id);
+            switch(msg.payload.index())
             {
-                msg.payload = convert_health(health);
+                case 0:
+                {
+                    const auto& error = std::get<std::string>(msg.payload);
+                    if (!error.empty())
+                        doc.put("error", webpier::locale_to_utf8(error));
+                    break;
+                }
+                case 1:
+                {
+                    doc.put_child("handle", convert_handle(std::get<slipway::handle>(msg.payload)));
+                    break;
+                }
+                case 2:
+                {
+                    doc.put_child("health", convert_health(std::get<slipway::health>(msg.payload)));
+                    break;
+                }
+                case 3:
+                {
+                    doc.put_child("report", convert_report(std::get<slipway::report>(msg.payload)));
+                    break;
+                }
+                case 4:
+                {
+                    boost::property_tree::ptree health;
+                    for (const auto& item : std::get<std::vector<slipway::health>>(msg.payload))
+                        health.push_back(std::make_pair("", convert_health(item)));
+                    doc.put_child("health", health);
+                    break;
+                }
+                case 5:
+                {
+                    boost::property_tree::ptree report;
+                    for (const auto& item : std::get<std::vector<slipway::report>>(msg.payload))
+                        report.push_back(std::make_pair("", convert_report(item)));
+                    doc.put_child("report", report);
+                    break;
+                }
+                case 6:
+                {
+                    doc.put("version", std::get<uint32_t>(msg.payload));
+                    break;
+                }
+                case 7:
+                {
+                    boost::property_tree::ptree handles;
+                    for (const auto& item : std::get<std::vector<slipway::handle>>(msg.payload))
+                        handles.push_back(std::make_pair("", convert_handle(item)));
+                    doc.put_child("handles", handles);
+                    break;
+                }
+                case 8:
+                {
+                    doc.put_child("query", convert_query(std::get<slipway::query>(msg.payload)));
+                    break;
+                }
+                case 9:
+                {
+                    doc.put_child("digest", convert_digest(std::get<slipway::digest>(msg.payload)));
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            std::ostringstream ss;
+            boost::property_tree::write_json(ss, doc, false);
+
+            std::string data = ss.str();
+
+            if (data.empty() || data.back() != '\n') {
+                data += '\n';
             }
+
+            if (data.size() > max_message_size)
+                throw pipe_error("Too large message");
+
+            if (buffer.sputn(data.data(), data.size()) != static_cast<std::streamsize>(data.size()))
+                throw pipe_error("Can't write message");
         }
-        else if (doc.count("report"))
+
+        void pull_json(std::streambuf& buffer, slipway::message& msg) noexcept(false)
         {
-            boost::property_tree::ptree report;
-            report = doc.get_child("report", report);
-            if (report.count("") || report.empty())
+            std::istream stream(&buffer);
+            std::string line;
+            std::getline(stream, line);
+
+            std::istringstream ss(line);
+            boost::property_tree::ptree doc;
+            boost::property_tree::read_json(ss, doc);
+
+            msg.action = static_cast<message::command>(doc.get<int>("action"));
+            msg.id = doc.get<uint32_t>("id", 0);
+            msg.payload = {};
+
+            if (doc.count("error"))
+            {
+                msg.payload = webpier::utf8_to_locale(doc.get<std::string>("error"));
+            }
+            else if (doc.count("handle"))
             {
-                std::vector<slipway::report> list;
-                for (const auto& item : report)
-                    list.emplace_back(convert_report(item.second));
+                msg.payload = convert_handle(doc.get_child("handle"));
+            }
+            else if (doc.count("health"))
+            {
+                boost::property_tree::ptree health;
+                health = doc.get_child("health", health);
+                if (health.count("") || health.empty())
+                {
+                    std::vector<slipway::health> list;
+                    for (const auto& item : health)
+                        list.emplace_back(convert_health(item.second));
+                    msg.payload = list;
+                }
+                else
+                {
+                    msg.payload = convert_health(health);
+                }
+            }
+            else if (doc.count("report"))
+            {
+                boost::property_tree::ptree report;
+                report = doc.get_child("report", report);
+                if (report.count("") || report.empty())
+                {
+                    std::vector<slipway::report> list;
+                    for (const auto& item : report)
+                        list.emplace_back(convert_report(item.second));
+                    msg.payload = list;
+                }
+                else
+                {
+                    msg.payload = convert_report(report);
+                }
+            }
+            else if (doc.count("version"))
+            {
+                msg.payload = doc.get<uint32_t>("version");
+            }
+            else if (doc.count("handles"))
+            {
+                std::vector<slipway::handle> list;
+                for (const auto& item : doc.get_child("handles"))
+                    list.emplace_back(convert_handle(item.second));
                 msg.payload = list;
             }
-            else
+            else if (doc.count("query"))
+            {
+                msg.payload = convert_query(doc.get_child("query"));
+            }
+            else if (doc.count("digest"))
             {
-                msg.payload = convert_report(report);
+                msg.payload = convert_digest(doc.get_child("digest"));
             }
         }
     }
+
+    void push_message(std::streambuf& buffer, const slipway::message& msg, codec format) noexcept(false)
+    {
+        format == binary ? push_binary(buffer, msg) : push_json(buffer, msg);
+    }
+
+    void pull_message(std::streambuf& buffer, slipway::message& msg, codec format) noexcept(false)
+    {
+        format == binary ? pull_binary(buffer, msg) : pull_json(buffer, msg);
+    }
 }
@@ -2,21 +2,28 @@
 
 #include <vector>
 #include <variant>
+#include <tuple>
 #include <stdexcept>
 #include <streambuf>
+#include <algorithm>
+#include <type_traits>
 #include <cstdint>
+#include <boost/asio/read_until.hpp>
 
 namespace slipway
 {
     struct task_error : public std::runtime_error { task_error(const std::string& what) : std::runtime_error(what) {} };
     struct pipe_error : public std::runtime_error { pipe_error(const std::string& what) : std::runtime_error(what) {} };
 
+    constexpr const uint32_t message_version = 1;
+    constexpr const size_t max_message_size = 16 * 1024 * 1024;
+
     struct handle
     {
         std::string pier;
         std::string service;
 
-        bool operator<(const handle& other) const { return pier + service < other.pier + other.service; }
+        bool operator<(const handle& other) const { return std::tie(pier, service) < std::tie(other.pier, other.service); }
         bool operator==(const handle& other) const { return pier == other.pier && service == other.service; }
     };
 
@@ -54,6 +61,51 @@ namespace slipway
         bool operator==(const report& other) const { return health::operator==(other) && burden == other.burden; }
     };
 
+    struct query
+    {
+        enum scope
+        {
+            anyone,
+            exports,
+            imports
+        };
+
+        enum field
+        {
+            state = 1,
+            message = 2,
+            tunnels = 4
+        };
+
+        std::string pier; // empty - any pier
+        scope side = anyone;
+        uint8_t states = 0; // mask of (1 << health::status), 0 - any state
+        uint8_t fields = state | message | tunnels; // the handle is always sent
+        slipway::handle after; // cursor, the last handle of the previous page
+        uint32_t limit = 0; // page size, 0 - unlimited
+        uint64_t since = 0; // stamp of the known snapshot, 0 - unknown
+
+        bool operator==(const query& other) const
+        {
+            return pier == other.pier && side == other.side && states == other.states && fields == other.fields
+                && after == other.after && limit == other.limit && since == other.since;
+        }
+    };
+
+    struct digest
+    {
+        uint64_t stamp = 0; // stamp of the actual snapshot
+        bool changed = true; // false if the snapshot matches the 'since' stamp of the query, the items are not sent then
+        bool more = false; // next page is available after the last item
+        uint8_t fields = query::state | query::message | query::tunnels;
+        std::vector<slipway::report> items;
+
+        bool operator==(const digest& other) const
+        {
+            return stamp == other.stamp && changed == other.changed && more == other.more && fields == other.fields && items == other.items;
+        }
+    };
+
     struct message
     {
         enum command
@@ -63,7 +115,8 @@ namespace slipway
             engage,
             adjust,
             status,
-            review
+            review,
+            accord
         };
 
         using content = std::variant<std::string, // error
@@ -71,10 +124,15 @@ namespace slipway
                                      slipway::health,
                                      slipway::report,
                                      std::vector<slipway::health>,
-                                     std::vector<slipway::report>>;
+                                     std::vector<slipway::report>,
+                                     uint32_t, // version
+                                     std::vector<slipway::handle>, // empty service name selects all services of the pier
+                                     slipway::query,
+                                     slipway::digest>;
 
         command action = command::naught;
         content payload;
+        uint32_t id = 0; // request id echoed by the response
 
         static message make(command action) noexcept(true)
         {
@@ -92,6 +150,53 @@ namespace slipway
         }
     };
 
-    void push_message(std::streambuf& buffer, const message& message) noexcept(true);
-    void pull_message(std::streambuf& buffer, message& message) noexcept(false);
+    enum codec
+    {
+        json, // newline delimited json, the fallback for the peers not supporting the accord
+        binary // length prefixed binary, available after the accord
+    };
+
+    // match condition for the async_read_until to read the whole message
+    class frame
+    {
+        codec m_format;
+
+    public:
+
+        explicit frame(codec format) : m_format(format) {}
+
+        template<class iterator>
+        std::pair<iterator, bool> operator()(iterator begin, iterator end) const
+        {
+            if (m_format == json)
+            {
+                auto iter = std::find(begin, end, '\n');
+                return iter == end ? std::make_pair(end, false) : std::make_pair(++iter, true);
+            }
+
+            if (std::distance(begin, end) < 4)
+                return std::make_pair(begin, false);
+
+            auto iter = begin;
+            size_t size = 0;
+            for (size_t i = 0; i < 4; ++i, ++iter)
+                size |= static_cast<size_t>(static_cast<uint8_t>(*iter)) << (i * 8);
+
+            if (static_cast<size_t>(std::distance(iter, end)) < size)
+                return std::make_pair(begin, false);
+
+            std::advance(iter, size);
+            return std::make_pair(iter, true);
+        }
+    };
+
+    // the message larger than 'max_message_size' is not written and the 'pipe_error' is thrown
+    void push_message(std::streambuf& buffer, const message& message, codec format = json) noexcept(false);
+    void pull_message(std::streambuf& buffer, message& message, codec format = json) noexcept(false);
 }
+
+namespace boost { namespace asio {
+
+template<> struct is_match_condition<slipway::frame> : public std::true_type {};
+
+}}
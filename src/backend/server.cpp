@@ -2,6 +2,8 @@
 #include <backend/message.h>
 #include <backend/ipc.h>
 #include <store/context.h>
+#include <store/index.h>
+#include <store/watcher.h>
 #include <store/utils.h>
 #include <plexus/plexus.h>
 #include <wormhole/logger.h>
@@ -14,14 +16,23 @@
 #include <boost/algorithm/string.hpp>
 #include <filesystem>
 #include <iostream>
+#include <fstream>
 #include <memory>
 #include <map>
+#include <algorithm>
 #include <set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include <boost/version.hpp>
 
 #if BOOST_VERSION >= 108800
     #include <boost/process/v1/child.hpp>
+    #include <boost/process/v1/io.hpp>
+    #include <boost/process/v1/async_pipe.hpp>
     #ifdef WIN32
         #include <boost/process/v1/windows.hpp>
     #endif
@@ -131,6 +142,117 @@ namespace slipway
             }
         }
 
+        class collector : public std::enable_shared_from_this<collector>
+        {
+            static constexpr size_t max_line_size = 64 * 1024;
+            static constexpr size_t max_pending_size = 1024 * 1024;
+
+            std::mutex m_mutex;
+            std::condition_variable m_cond;
+            std::string m_folder;
+            std::string m_pending;
+            size_t m_dropped = 0;
+            bool m_stop = false;
+            std::thread m_thread;
+
+            static void flush(const std::string& folder, const std::string& data, size_t dropped) noexcept(true)
+            {
+                if (folder.empty())
+                    return;
+
+                std::ofstream file(folder + webpier::make_timestamp("/carrier.%Y%m%d.log"), std::ios::app | std::ios::binary);
+                file << data;
+
+                if (dropped)
+                    file << webpier::make_timestamp("[%d-%m-%Y %H:%M:%S] ") << "dropped " << dropped << " lines" << std::endl;
+            }
+
+            void append(std::string&& line) noexcept(true)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+
+                if (m_pending.size() + line.size() > max_pending_size)
+                    ++m_dropped;
+                else
+                    m_pending.append(line);
+            }
+
+            void read(const std::shared_ptr<bp::async_pipe>& pipe, const std::shared_ptr<boost::asio::streambuf>& buffer, const std::string& prefix) noexcept(true)
+            {
+                boost::asio::async_read_until(*pipe, *buffer, '\n', [self = shared_from_this(), pipe, buffer, prefix](const boost::system::error_code& ec, size_t size)
+                {
+                    if (ec && buffer->size() > 0)
+                        size = buffer->size();
+
+                    if (size > 0)
+                    {
+                        std::string line = prefix;
+                        line.append(boost::asio::buffers_begin(buffer->data()), boost::asio::buffers_begin(buffer->data()) + size);
+                        buffer->consume(size);
+
+                        if (line.back() != '\n')
+                            line.push_back('\n');
+
+                        self->append(std::move(line));
+                    }
+
+                    if (!ec || ec == boost::asio::error::not_found)
+                        self->read(pipe, buffer, prefix);
+                });
+            }
+
+        public:
+
+            collector()
+            {
+                m_thread = std::thread([this]()
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    while (!m_stop)
+                    {
+                        m_cond.wait_for(lock, std::chrono::seconds(1), [this]() { return m_stop; });
+
+                        if (m_pending.empty() && m_dropped == 0)
+                            continue;
+
+                        std::string data;
+                        data.swap(m_pending);
+                        size_t dropped = std::exchange(m_dropped, 0);
+                        std::string folder = m_folder;
+
+                        lock.unlock();
+                        flush(folder, data, dropped);
+                        lock.lock();
+                    }
+                });
+            }
+
+            ~collector()
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cond.notify_all();
+                m_thread.join();
+            }
+
+            void employ(const std::string& folder) noexcept(true)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_folder = folder;
+            }
+
+            void attach(const std::shared_ptr<bp::async_pipe>& pipe, bp::pid_t pid) noexcept(true)
+            {
+                read(pipe, std::make_shared<boost::asio::streambuf>(max_line_size), "<" + std::to_string(pid) + "> ");
+            }
+        };
+
+        using collector_ptr = std::shared_ptr<collector>;
+        using config_ptr = std::shared_ptr<const webpier::config>;
+        using generation_ptr = std::shared_ptr<std::atomic<uint64_t>>; // bumped on any change of the service health
+
         class controller : public std::enable_shared_from_this<controller>
         {
             class connector : public std::enable_shared_from_this<connector>
@@ -143,7 +265,7 @@ namespace slipway
                 {
                     struct
                     {
-                        webpier::config   config;
+                        config_ptr        config;
                         webpier::service  service;
                         plexus::connector connect;
                         plexus::fallback  fallback;
@@ -155,7 +277,7 @@ namespace slipway
 
                 public:
 
-                    spawner(const webpier::config& config, const webpier::service& service, const plexus::connector& connect, const plexus::fallback& fallback)
+                    spawner(const config_ptr& config, const webpier::service& service, const plexus::connector& connect, const plexus::fallback& fallback)
                     {
                         m_data.config = config;
                         m_data.service = service;
@@ -190,12 +312,12 @@ namespace slipway
 
                         m_thread = std::make_unique<std::thread>([this]()
                         {
-                            plexus::identity host { m_data.config.pier.substr(0, m_data.config.pier.find('/')), m_data.config.pier.substr(m_data.config.pier.find('/') + 1) };
+                            plexus::identity host { m_data.config->pier.substr(0, m_data.config->pier.find('/')), m_data.config->pier.substr(m_data.config->pier.find('/') + 1) };
                             plexus::identity peer { m_data.service.pier.substr(0, m_data.service.pier.find('/')), m_data.service.pier.substr(m_data.service.pier.find('/') + 1) };
 
                             try
                             {
-                                auto config = utils::make_options(m_data.config, m_data.service);
+                                auto config = utils::make_options(*m_data.config, m_data.service);
 
                                 m_data.service.local
                                     ? plexus::spawn_accept(*m_io, config, host, peer, m_data.connect, m_data.fallback)
@@ -216,57 +338,79 @@ namespace slipway
                 {
                     bp::environment env = boost::this_process::environment();
                     env["WORMHOLE_SECRET"] = std::to_string(term.secret);
-                    env["WORMHOLE_CERT"] = webpier::make_path(m_config.repo, host.owner, host.pin, "cert.crt");
-                    env["WORMHOLE_KEY"] = webpier::make_path(m_config.repo, host.owner, host.pin, "private.key");
-                    env["WORMHOLE_CA"] = webpier::make_path(m_config.repo, peer.owner, peer.pin, "cert.crt");
+                    env["WORMHOLE_CERT"] = webpier::make_path(m_config->repo, host.owner, host.pin, "cert.crt");
+                    env["WORMHOLE_KEY"] = webpier::make_path(m_config->repo, host.owner, host.pin, "private.key");
+                    env["WORMHOLE_CA"] = webpier::make_path(m_config->repo, peer.owner, peer.pin, "cert.crt");
 
                     auto pid = std::make_shared<bp::pid_t>(0);
-                    bp::child proc(m_io, webpier::get_module_path(webpier::carrier_module).string(),
-                        "--purpose=" + std::string(m_service.local ? "export" : "import"),
-                        "--service=" + m_service.address,
-                        "--gateway=" + wormhole::endpoint::to_string(term.inner),
-                        "--faraway=" + wormhole::endpoint::to_string(term.alien),
-                        "--quality=" + wormhole::criteria::to_string(term.qos),
-                        "--journal=" + webpier::make_path(m_config.log.folder, "carrier.%p.log"),
-                        "--logging=" + std::to_string(m_config.log.level),
-                        bp::on_exit = [this, weak = weak_from_this(), pid](int code, const std::error_code& ec)
-                        {
-                            if (ec && ec != std::errc::no_child_process)
-                                _err_ << ec.message();
+                    auto launch = [&](auto&&... redirect)
+                    {
+                        return bp::child(m_io, webpier::get_module_path(webpier::carrier_module).string(),
+                            "--purpose=" + std::string(m_service.local ? "export" : "import"),
+                            "--service=" + m_service.address,
+                            "--gateway=" + wormhole::endpoint::to_string(term.inner),
+                            "--faraway=" + wormhole::endpoint::to_string(term.alien),
+                            "--quality=" + wormhole::criteria::to_string(term.qos),
+                            "--journal=" + (m_config->log.merge ? std::string() : webpier::make_path(m_config->log.folder, "carrier.%p.log")),
+                            "--logging=" + std::to_string(m_config->log.level),
+                            bp::on_exit = [this, weak = weak_from_this(), pid](int code, const std::error_code& ec)
+                            {
+                                if (ec && ec != std::errc::no_child_process)
+                                    _err_ << ec.message();
 
-                            _inf_ << "joined " << *pid << " tunnel with exit code " << code;
+                                _inf_ << "joined " << *pid << " tunnel with exit code " << code;
 
-                            if (auto ptr = weak.lock())
-                            {
-                                m_tunnels.erase(pid);
-                                if (m_service.local == false)
+                                if (auto ptr = weak.lock())
                                 {
-                                    m_error.clear();
-                                    m_spawner->startup();
+                                    m_tunnels.erase(pid);
+                                    ++*m_generation;
+
+                                    if (m_service.local == false)
+                                    {
+                                        m_error.clear();
+                                        m_spawner->startup();
+                                    }
                                 }
-                            }
-                        },
+                            },
 #ifdef WIN32
-                        bp::windows::hide,
+                            bp::windows::hide,
 #endif
-                        bp::env = env
-                    );
+                            redirect...,
+                            bp::env = env
+                        );
+                    };
+
+                    bp::child proc;
+                    if (m_config->log.merge)
+                    {
+                        auto pipe = std::make_shared<bp::async_pipe>(m_io);
+                        proc = launch((bp::std_out & bp::std_err) > *pipe);
+
+                        m_collector->employ(m_config->log.folder);
+                        m_collector->attach(pipe, proc.id());
+                    }
+                    else
+                    {
+                        proc = launch();
+                    }
 
                     *pid = proc.id();
                     m_tunnels.emplace(pid, std::move(proc));
+                    ++*m_generation;
  
                     m_service.local
-                        ? _inf_ << "launch " << *pid << " export tunnel " << m_config.pier << ":" << m_service.name << " -> " << m_service.pier
-                        : _inf_ << "launch " << *pid << " import tunnel " << m_service.pier << ":" << m_service.name << " -> " << m_config.pier;
+                        ? _inf_ << "launch " << *pid << " export tunnel " << m_config->pier << ":" << m_service.name << " -> " << m_service.pier
+                        : _inf_ << "launch " << *pid << " import tunnel " << m_service.pier << ":" << m_service.name << " -> " << m_config->pier;
                 }
 
                 void fallback(const std::string& error)
                 {
                     m_error = error;
+                    ++*m_generation;
 
                     m_service.local
-                        ? _err_ << "export service " << m_config.pier << ":" << m_service.name << " -> " << m_service.pier << " failed: " << error
-                        : _err_ << "import service " << m_service.pier << ":" << m_service.name << " -> " << m_config.pier << " failed: " << error;
+                        ? _err_ << "export service " << m_config->pier << ":" << m_service.name << " -> " << m_service.pier << " failed: " << error
+                        : _err_ << "import service " << m_service.pier << ":" << m_service.name << " -> " << m_config->pier << " failed: " << error;
 
                     m_timer.expires_from_now(utils::get_retry_timeout());
                     m_timer.async_wait([this, weak = weak_from_this()](const boost::system::error_code& ec)
@@ -277,6 +421,7 @@ namespace slipway
                         if(auto ptr = weak.lock())
                         {
                             m_error.clear();
+                            ++*m_generation;
 
                             if (m_service.local && m_spawner->active())
                                 return;
@@ -288,14 +433,19 @@ namespace slipway
 
             public:
 
-                connector(boost::asio::io_context& io)
+                connector(boost::asio::io_context& io, collector_ptr collector, generation_ptr generation)
                     : m_io(io)
                     , m_timer(io)
+                    , m_collector(collector)
+                    , m_generation(generation)
                 {
+                    ++*m_generation;
                 }
 
                 ~connector()
                 {
+                    ++*m_generation;
+
                     boost::system::error_code ec;
                     m_timer.cancel(ec);
 
@@ -310,7 +460,7 @@ namespace slipway
                     }
                 }
 
-                void restart(const webpier::config& config, const webpier::service& service)
+                void restart(const config_ptr& config, const webpier::service& service)
                 {
                     boost::system::error_code ec;
                     m_timer.cancel(ec);
@@ -352,6 +502,8 @@ namespace slipway
                         m_error.clear();
                         m_spawner->startup();
                     }
+
+                    ++*m_generation;
                 }
 
                 bool broken() const
@@ -383,7 +535,9 @@ namespace slipway
 
                 boost::asio::io_context&     m_io;
                 boost::asio::deadline_timer  m_timer;
-                webpier::config              m_config;
+                collector_ptr                m_collector;
+                generation_ptr               m_generation;
+                config_ptr                   m_config;
                 webpier::service             m_service;
                 std::unique_ptr<spawner>     m_spawner;
                 std::string                  m_error;
@@ -392,13 +546,24 @@ namespace slipway
 
         public:
 
-            controller(boost::asio::io_context& io)
+            controller(boost::asio::io_context& io, collector_ptr collector, generation_ptr generation)
                 : m_io(io)
+                , m_collector(collector)
+                , m_generation(generation)
+            {
+                ++*m_generation;
+            }
+
+            ~controller()
             {
+                ++*m_generation;
             }
 
-            void restart(const webpier::config& config, const webpier::service& service)
+            void restart(const config_ptr& config, const webpier::service& service)
             {
+                m_config = config;
+                m_service = service;
+
                 std::set<std::string> piers;
                 boost::split(piers, service.pier, boost::is_any_of(" "));
 
@@ -418,7 +583,7 @@ namespace slipway
 
                     auto iter = m_bundle.find(pier);
                     if (iter == m_bundle.end())
-                        iter = m_bundle.emplace(pier, std::make_shared<connector>(m_io)).first;
+                        iter = m_bundle.emplace(pier, std::make_shared<connector>(m_io, m_collector, m_generation)).first;
 
                     iter->second->restart(config, single);
                 }
@@ -429,6 +594,16 @@ namespace slipway
                 m_bundle.clear();
             }
 
+            const config_ptr& config() const
+            {
+                return m_config;
+            }
+
+            const webpier::service& service() const
+            {
+                return m_service;
+            }
+
             health::status state() const
             {
                 health::status res = m_bundle.empty() ? health::asleep : health::lonely;
@@ -472,14 +647,173 @@ namespace slipway
         private:
 
             boost::asio::io_context& m_io;
-            std::map<std::string, std::shared_ptr<connector>> m_bundle;
+            collector_ptr m_collector;
+            generation_ptr m_generation;
+            config_ptr m_config;
+            webpier::service m_service;
+            std::unordered_map<std::string, std::shared_ptr<connector>> m_bundle;
+        };
+
+        // interns the handles to stable ids, the id of the removed handle stays bound to it until the slot is taken by a new handle
+        template<class value>
+        class registry
+        {
+            using slot = std::pair<slipway::handle, std::shared_ptr<value>>;
+
+            struct hasher
+            {
+                size_t operator()(const slipway::handle& id) const noexcept(true)
+                {
+                    size_t seed = std::hash<std::string>()(id.pier);
+                    return seed ^ (std::hash<std::string>()(id.service) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+                }
+            };
+
+            std::vector<slot> m_slots;
+            std::vector<bool> m_queued;
+            std::unordered_map<slipway::handle, uint32_t, hasher> m_ids;
+            std::vector<uint32_t> m_free;
+            size_t m_size = 0;
+
+        public:
+
+            class iterator
+            {
+                friend class registry;
+
+                typename std::vector<slot>::iterator m_iter;
+                typename std::vector<slot>::iterator m_end;
+
+                iterator(typename std::vector<slot>::iterator iter, typename std::vector<slot>::iterator end)
+                    : m_iter(iter)
+                    , m_end(end)
+                {
+                    while (m_iter != m_end && !m_iter->second)
+                        ++m_iter;
+                }
+
+            public:
+
+                slot& operator*() const { return *m_iter; }
+                slot* operator->() const { return &*m_iter; }
+                bool operator==(const iterator& other) const { return m_iter == other.m_iter; }
+                bool operator!=(const iterator& other) const { return m_iter != other.m_iter; }
+
+                iterator& operator++()
+                {
+                    do { ++m_iter; } while (m_iter != m_end && !m_iter->second);
+                    return *this;
+                }
+            };
+
+            iterator begin() noexcept(true)
+            {
+                return iterator(m_slots.begin(), m_slots.end());
+            }
+
+            iterator end() noexcept(true)
+            {
+                return iterator(m_slots.end(), m_slots.end());
+            }
+
+            size_t size() const noexcept(true)
+            {
+                return m_size;
+            }
+
+            uint32_t intern(const slipway::handle& id) noexcept(false)
+            {
+                auto iter = m_ids.find(id);
+                if (iter != m_ids.end())
+                    return iter->second;
+
+                while (!m_free.empty())
+                {
+                    auto number = m_free.back();
+                    m_free.pop_back();
+                    m_queued[number] = false;
+
+                    auto& entry = m_slots[number];
+                    if (entry.second)
+                        continue;
+
+                    m_ids.erase(entry.first);
+                    m_ids.emplace(id, number);
+                    entry.first = id;
+                    return number;
+                }
+
+                auto number = static_cast<uint32_t>(m_slots.size());
+                m_slots.emplace_back(id, nullptr);
+                m_queued.push_back(false);
+                m_ids.emplace(id, number);
+                return number;
+            }
+
+            uint32_t index(const iterator& iter) const noexcept(true)
+            {
+                return static_cast<uint32_t>(iter.m_iter - iter.m_end + m_slots.size());
+            }
+
+            iterator find(const slipway::handle& id) noexcept(true)
+            {
+                auto iter = m_ids.find(id);
+                return iter == m_ids.end() || !m_slots[iter->second].second
+                    ? end()
+                    : iterator(m_slots.begin() + iter->second, m_slots.end());
+            }
+
+            // the iterator following the handle in the slot order, the handle must be interned
+            iterator next(const slipway::handle& id) noexcept(false)
+            {
+                auto iter = m_ids.find(id);
+                if (iter == m_ids.end())
+                    throw std::runtime_error("unknown cursor");
+
+                return iterator(m_slots.begin() + iter->second + 1, m_slots.end());
+            }
+
+            std::pair<iterator, bool> emplace(const slipway::handle& id, const std::shared_ptr<value>& item) noexcept(false)
+            {
+                auto& entry = m_slots[intern(id)];
+                bool fresh = !entry.second;
+                if (fresh)
+                {
+                    entry.second = item;
+                    ++m_size;
+                }
+                return std::make_pair(iterator(m_slots.begin() + (&entry - m_slots.data()), m_slots.end()), fresh);
+            }
+
+            iterator erase(iterator iter) noexcept(true)
+            {
+                auto number = index(iter);
+                iter.m_iter->second.reset();
+                if (!m_queued[number])
+                {
+                    m_queued[number] = true;
+                    m_free.push_back(number);
+                }
+                --m_size;
+                return ++iter;
+            }
         };
 
         class engine
         {
             boost::asio::io_context& m_io;
             std::filesystem::path m_home;
-            std::map<handle, std::shared_ptr<controller>> m_pool;
+            collector_ptr m_collector;
+            generation_ptr m_generation;
+            registry<controller> m_pool;
+            std::string m_host;
+            std::filesystem::path m_repo;
+            std::filesystem::path m_watched;
+            std::map<std::string, webpier::stamp> m_stamps;
+            webpier::stamp m_index;
+            boost::asio::steady_timer m_delay;
+            std::vector<webpier::watcher_ptr> m_watchers;
+            std::atomic<bool> m_stopped;
 
             struct quard
             {
@@ -503,7 +837,7 @@ namespace slipway
                 boost::interprocess::scoped_lock<boost::interprocess::file_lock> m_lock;
             };
 
-            webpier::config load_config() noexcept(false)
+            config_ptr load_config() noexcept(false)
             {
                 auto file = m_home / webpier_conf_file_name;
 
@@ -515,10 +849,13 @@ namespace slipway
 
                 wormhole::log::set(wormhole::log::severity(level), utils::make_log_path(folder));
 
-                return webpier::config {
+                m_host = webpier::utf8_to_locale(doc.get<std::string>("pier"));
+                m_repo = webpier::utf8_to_locale(doc.get<std::string>("repo"));
+
+                return std::make_shared<const webpier::config>(webpier::config {
                     webpier::utf8_to_locale(doc.get<std::string>("pier")),
                     webpier::utf8_to_locale(doc.get<std::string>("repo")),
-                    webpier::journal { folder, level },
+                    webpier::journal { folder, level, doc.get<bool>("log.merge", false) },
                     webpier::puncher {
                         webpier::utf8_to_locale(doc.get<std::string>("nat.stun.udp", doc.get<std::string>("nat.stun", webpier::default_udp_stun_server))),
                         webpier::utf8_to_locale(doc.get<std::string>("nat.stun.tcp", webpier::default_tcp_stun_server)),
@@ -545,38 +882,35 @@ namespace slipway
                         webpier::utf8_to_locale(doc.get<std::string>("relay.key", "")),
                         webpier::utf8_to_locale(doc.get<std::string>("relay.ca", ""))
                     }
-                };
+                });
             }
 
             webpier::service load_config(const std::filesystem::path& repo, const slipway::handle& id) noexcept(false)
             {
-                auto path = repo / id.pier / webpier_conf_file_name;
-                if (std::filesystem::exists(path))
+                if (webpier::exists_index(repo))
                 {
-                    boost::property_tree::ptree doc;
-                    boost::property_tree::read_json(path.string(), doc);
+                    webpier::catalog data;
+                    webpier::load_index(repo, data);
 
-                    boost::property_tree::ptree array;
-                    for (auto& item : doc.get_child("services", array))
+                    auto pier = data.find(id.pier);
+                    if (pier != data.end())
                     {
-                        if (webpier::utf8_to_locale(item.second.get<std::string>("name")) == id.service)
+                        for (auto& serv : pier->second)
                         {
-                            auto local = item.second.get<bool>("local");
-                            return webpier::service {
-                                local,
-                                webpier::utf8_to_locale(item.second.get<std::string>("name")),
-                                webpier::utf8_to_locale(item.second.get<std::string>("pier")),
-                                webpier::utf8_to_locale(item.second.get<std::string>("address")),
-                                webpier::utf8_to_locale(item.second.get<std::string>("gateway", webpier::default_ip4_gateway)),
-                                webpier::utf8_to_locale(item.second.get<std::string>("rendezvous", "")),
-                                wormhole::protocol(item.second.get<int>("proto", wormhole::protocol::udp)),
-                                wormhole::schema(item.second.get<int>("role", wormhole::schema::either)),
-                                plexus::routing::favour(item.second.get<int>("route", plexus::routing::direct)),
-                                item.second.get<bool>("autostart", false),
-                                item.second.get<bool>("obscure", true),
-                            };
+                            if (serv.name == id.service)
+                                return serv;
                         }
                     }
+                    return webpier::service{};
+                }
+
+                std::vector<webpier::service> list;
+                webpier::load_pier_services(repo, id.pier, id.pier == m_host, list);
+
+                for (auto& serv : list)
+                {
+                    if (serv.name == id.service)
+                        return serv;
                 }
 
                 return webpier::service{};
@@ -584,7 +918,31 @@ namespace slipway
 
             std::map<std::string, std::vector<webpier::service>> load_config(const std::filesystem::path& repo) noexcept(false)
             {
+                if (webpier::exists_index(repo))
+                {
+                    webpier::catalog data;
+                    webpier::load_index(repo, data);
+                    return data;
+                }
+
                 std::map<std::string, std::vector<webpier::service>> res;
+                for (const auto& pier : list_piers(repo))
+                    res[pier] = load_config(repo, pier);
+
+                return std::map<std::string, std::vector<webpier::service>>(std::move(res));
+            }
+
+            std::vector<webpier::service> load_config(const std::filesystem::path& repo, const std::string& pier) noexcept(false)
+            {
+                std::vector<webpier::service> res;
+                webpier::load_pier_services(repo, pier, pier == m_host, res);
+
+                return res;
+            }
+
+            std::vector<std::string> list_piers(const std::filesystem::path& repo) const noexcept(false)
+            {
+                std::vector<std::string> res;
                 for (auto const& owner : std::filesystem::directory_iterator(repo))
                 {
                     if (!owner.is_directory())
@@ -595,58 +953,224 @@ namespace slipway
                         if (!pin.is_directory())
                             continue;
 
-                        auto conf = pin.path() / webpier_conf_file_name;
-                        if (!std::filesystem::exists(conf))
+                        if (!std::filesystem::exists(pin.path() / webpier_conf_file_name))
+                            continue;
+
+                        res.push_back(owner.path().filename().string() + "/" + pin.path().filename().string());
+                    }
+                }
+                return res;
+            }
+
+            void retain(const std::vector<uint32_t>& live) noexcept(true)
+            {
+                std::vector<bool> mask;
+                for (auto index : live)
+                {
+                    if (mask.size() <= index)
+                        mask.resize(index + 1);
+                    mask[index] = true;
+                }
+
+                auto iter = m_pool.begin();
+                while (iter != m_pool.end())
+                {
+                    auto index = m_pool.index(iter);
+                    if (index < mask.size() && mask[index])
+                    {
+                        ++iter;
+                        continue;
+                    }
+
+                    _inf_ << "remove " << iter->first.pier << ":" << iter->first.service;
+                    iter = m_pool.erase(iter);
+                }
+            }
+
+            void seed() noexcept(false)
+            {
+                quard lock(m_home / webpier_lock_file_name);
+
+                auto conf = load_config();
+                auto repo = std::filesystem::path(conf->repo);
+
+                m_stamps.clear();
+                m_index = webpier::stamp();
+
+                if (webpier::exists_index(repo))
+                    m_index = webpier::stamp(repo / webpier::index_file_name);
+                else if (std::filesystem::exists(repo))
+                {
+                    for (const auto& pier : list_piers(repo))
+                        m_stamps[pier] = webpier::stamp(repo / pier / webpier_conf_file_name);
+                }
+            }
+
+            void watch() noexcept(false)
+            {
+                if (m_stopped || (!m_watchers.empty() && m_watched == m_repo))
+                    return;
+
+                auto notify = [this]()
+                {
+                    boost::asio::post(m_io, [this]()
+                    {
+                        schedule();
+                    });
+                };
+
+                m_watchers.clear();
+                m_watchers.push_back(webpier::watch_files(m_home, { webpier_conf_file_name }, notify));
+                m_watchers.push_back(webpier::watch_folder(m_repo, 2, notify));
+                m_watched = m_repo;
+            }
+
+            void schedule() noexcept(true)
+            {
+                if (m_stopped)
+                    return;
+
+                // a burst of file changes is applied once when it settles down
+                m_delay.expires_after(std::chrono::milliseconds(500));
+                m_delay.async_wait([this](const boost::system::error_code& ec)
+                {
+                    if (ec || m_stopped)
+                        return;
+
+                    try
+                    {
+                        reload();
+                        watch();
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        _err_ << "reload failed: " << ex.what();
+                    }
+                });
+            }
+
+            void reload() noexcept(false)
+            {
+                quard lock(m_home / webpier_lock_file_name);
+
+                auto conf = load_config();
+
+                std::map<std::string, std::vector<webpier::service>> changed;
+                std::set<std::string> piers;
+
+                // the stamps are taken before the files are read and kept only when the changes are applied
+                std::map<std::string, webpier::stamp> stamps;
+                webpier::stamp index;
+
+                if (webpier::exists_index(conf->repo))
+                {
+                    index = webpier::stamp(std::filesystem::path(conf->repo) / webpier::index_file_name);
+                    if (index == m_index)
+                    {
+                        for (auto iter = m_pool.begin(); iter != m_pool.end(); ++iter)
+                            piers.insert(iter->first.pier);
+                    }
+                    else
+                    {
+                        webpier::load_index(conf->repo, changed);
+
+                        for (const auto& pier : changed)
+                            piers.insert(pier.first);
+                    }
+                }
+                else if (std::filesystem::exists(conf->repo))
+                {
+                    for (const auto& pier : list_piers(conf->repo))
+                    {
+                        piers.insert(pier);
+
+                        auto mark = stamps[pier] = webpier::stamp(std::filesystem::path(conf->repo) / pier / webpier_conf_file_name);
+                        auto iter = m_stamps.find(pier);
+                        if (iter != m_stamps.end() && iter->second == mark)
                             continue;
 
-                        auto pier = owner.path().filename().string() + "/" + pin.path().filename().string();
+                        changed[pier] = load_config(conf->repo, pier);
+                    }
+                }
 
-                        boost::property_tree::ptree doc;
-                        boost::property_tree::read_json(conf.string(), doc);
+                _dbg_ << "reload " << changed.size() << " piers...";
 
-                        boost::property_tree::ptree array;
-                        for (auto& item : doc.get_child("services", array))
+                for (const auto& pier : changed)
+                {
+                    for (const auto& serv : pier.second)
+                    {
+                        handle id { pier.first, serv.name };
+
+                        auto iter = m_pool.find(id);
+                        if (iter == m_pool.end())
                         {
-                            auto local = item.second.get<bool>("local");
-                            res[pier].emplace_back(webpier::service {
-                                local,
-                                webpier::utf8_to_locale(item.second.get<std::string>("name")),
-                                webpier::utf8_to_locale(item.second.get<std::string>("pier")),
-                                webpier::utf8_to_locale(item.second.get<std::string>("address")),
-                                webpier::utf8_to_locale(item.second.get<std::string>("gateway", webpier::default_ip4_gateway)),
-                                webpier::utf8_to_locale(item.second.get<std::string>("rendezvous", "")),
-                                wormhole::protocol(item.second.get<int>("proto", wormhole::protocol::udp)),
-                                wormhole::schema(item.second.get<int>("role", local ? wormhole::schema::server : wormhole::schema::client)),
-                                plexus::routing::favour(item.second.get<int>("route", plexus::routing::direct)),
-                                item.second.get<bool>("autostart", false),
-                                item.second.get<bool>("obscure", true)
-                            });
+                            iter = m_pool.emplace(id, std::make_shared<controller>(m_io, m_collector, m_generation)).first;
+                            if (serv.autostart)
+                            {
+                                _inf_ << "restart " << id.pier << ":" << id.service;
+                                iter->second->restart(conf, serv);
+                            }
+                            else
+                            {
+                                _inf_ << "suspend " << id.pier << ":" << id.service;
+                                iter->second->suspend();
+                            }
+                        }
+                        else if (iter->second->state() != slipway::health::asleep && !(iter->second->service() == serv && *iter->second->config() == *conf))
+                        {
+                            _inf_ << "restart " << id.pier << ":" << id.service;
+                            iter->second->restart(conf, serv);
                         }
                     }
                 }
 
-                return std::map<std::string, std::vector<webpier::service>>(std::move(res));
+                auto iter = m_pool.begin();
+                while (iter != m_pool.end())
+                {
+                    auto pier = changed.find(iter->first.pier);
+                    if (piers.count(iter->first.pier) == 0 || (pier != changed.end() && std::none_of(pier->second.begin(), pier->second.end(), [&](const webpier::service& serv)
+                        {
+                            return serv.name == iter->first.service;
+                        })))
+                    {
+                        _inf_ << "remove " << iter->first.pier << ":" << iter->first.service;
+                        iter = m_pool.erase(iter);
+                        continue;
+                    }
+
+                    // the host config change concerns the running services of the untouched piers as well
+                    if (pier == changed.end() && iter->second->state() != slipway::health::asleep && !(*iter->second->config() == *conf))
+                    {
+                        _inf_ << "restart " << iter->first.pier << ":" << iter->first.service;
+                        iter->second->restart(conf, iter->second->service());
+                    }
+
+                    ++iter;
+                }
+
+                m_stamps = std::move(stamps);
+                m_index = index;
             }
 
             void engage() noexcept(false)
             {
                 quard lock(m_home / webpier_lock_file_name);
 
-                webpier::config conf = load_config();
+                auto conf = load_config();
 
                 _inf_ << "engage...";
 
-                std::map<handle, std::shared_ptr<controller>> pool;
-                for (const auto& pier : load_config(conf.repo))
+                std::vector<uint32_t> live;
+                for (const auto& pier : load_config(conf->repo))
                 {
                     for (const auto& serv : pier.second)
                     {
                         handle id { pier.first, serv.name };
+                        live.push_back(m_pool.intern(id));
 
                         auto iter = m_pool.find(id);
                         if (iter != m_pool.end())
                         {
-                            iter = pool.emplace(id, iter->second).first;
                             if (serv.autostart)
                             {
                                 _inf_ << "restart " << id.pier << ":" << id.service;
@@ -660,7 +1184,7 @@ namespace slipway
                         }
                         else
                         {
-                            iter = pool.emplace(id, std::make_shared<controller>(m_io)).first;
+                            iter = m_pool.emplace(id, std::make_shared<controller>(m_io, m_collector, m_generation)).first;
                             if (serv.autostart)
                             {
                                 _inf_ << "restart " << id.pier << ":" << id.service;
@@ -675,34 +1199,28 @@ namespace slipway
                     }
                 }
   
-                std::swap(m_pool, pool);
-                for (auto& item : pool)
-                {
-                    auto iter = m_pool.find(item.first);
-                    if (iter == m_pool.end())
-                        _inf_ << "remove " << item.first.pier << ":" << item.first.service;
-                }
+                retain(live);
             }
 
             void adjust() noexcept(false)
             {
                 quard lock(m_home / webpier_lock_file_name);
 
-                webpier::config conf = load_config();
+                auto conf = load_config();
 
                 _inf_ << "adjust...";
 
-                std::map<handle, std::shared_ptr<controller>> pool;
-                for (const auto& pier : load_config(conf.repo))
+                std::vector<uint32_t> live;
+                for (const auto& pier : load_config(conf->repo))
                 {
                     for (const auto& serv : pier.second)
                     {
                         handle id { pier.first, serv.name };
+                        live.push_back(m_pool.intern(id));
 
                         auto iter = m_pool.find(id);
                         if (iter != m_pool.end())
                         {
-                            iter = pool.emplace(id, iter->second).first;
                             if (iter->second->state() != slipway::health::asleep)
                             {
                                 _inf_ << "restart " << id.pier << ":" << id.service;
@@ -711,7 +1229,7 @@ namespace slipway
                         }
                         else
                         {
-                            iter = pool.emplace(id, std::make_shared<controller>(m_io)).first;
+                            iter = m_pool.emplace(id, std::make_shared<controller>(m_io, m_collector, m_generation)).first;
                             if (serv.autostart)
                             {
                                 _inf_ << "restart " << id.pier << ":" << id.service;
@@ -726,22 +1244,19 @@ namespace slipway
                     }
                 }
 
-                std::swap(m_pool, pool);
-                for (auto& item : pool)
-                {
-                    auto iter = m_pool.find(item.first);
-                    if (iter == m_pool.end())
-                        _inf_ << "remove " << item.first.pier << ":" << item.first.service;
-                }
+                retain(live);
             }
 
             void engage(const slipway::handle& id) noexcept(false)
             {
                 quard lock(m_home / webpier_lock_file_name);
 
-                webpier::config conf = load_config();
-                webpier::service serv = load_config(conf.repo, id);
+                auto conf = load_config();
+                engage(conf, id, load_config(conf->repo, id));
+            }
 
+            void engage(const config_ptr& conf, const slipway::handle& id, const webpier::service& serv) noexcept(false)
+            {
                 auto iter = m_pool.find(id);
                 if (serv.name.empty())
                 {
@@ -754,7 +1269,7 @@ namespace slipway
                 }
 
                 if (iter == m_pool.end())
-                    iter = m_pool.emplace(id, std::make_shared<controller>(m_io)).first;
+                    iter = m_pool.emplace(id, std::make_shared<controller>(m_io, m_collector, m_generation)).first;
 
                 _inf_ << "restart " << id.pier << ":" << id.service;
 
@@ -765,9 +1280,12 @@ namespace slipway
             {
                 quard lock(m_home / webpier_lock_file_name);
 
-                webpier::config conf = load_config();
-                webpier::service serv = load_config(conf.repo, id);
+                auto conf = load_config();
+                adjust(conf, id, load_config(conf->repo, id));
+            }
 
+            void adjust(const config_ptr& conf, const slipway::handle& id, const webpier::service& serv) noexcept(false)
+            {
                 auto iter = m_pool.find(id);
                 if (serv.name.empty())
                 {
@@ -781,7 +1299,7 @@ namespace slipway
 
                 if (iter == m_pool.end())
                 {
-                    iter = m_pool.emplace(id, std::make_shared<controller>(m_io)).first;
+                    iter = m_pool.emplace(id, std::make_shared<controller>(m_io, m_collector, m_generation)).first;
                     if (serv.autostart)
                     {
                         _inf_ << "restart " << id.pier << ":" << id.service;
@@ -804,26 +1322,26 @@ namespace slipway
             {
                 quard lock(m_home / webpier_lock_file_name);
 
-                webpier::config conf = load_config();
+                auto conf = load_config();
 
                 _inf_ << "unplug...";
 
-                std::map<handle, std::shared_ptr<controller>> pool;
-                for (const auto& pier : load_config(conf.repo))
+                std::vector<uint32_t> live;
+                for (const auto& pier : load_config(conf->repo))
                 {
                     for (const auto& serv : pier.second)
                     {
                         handle id { pier.first, serv.name };
+                        live.push_back(m_pool.intern(id));
 
                         auto iter = m_pool.find(id);
                         if (iter == m_pool.end())
                         {
-                            iter = pool.emplace(id, std::make_shared<controller>(m_io)).first;
+                            iter = m_pool.emplace(id, std::make_shared<controller>(m_io, m_collector, m_generation)).first;
                             _inf_ << "suspend " << pier.first << ":" << serv.name;
                         }
                         else
                         {
-                            iter = pool.emplace(id, iter->second).first;
                             if (iter->second->state() != slipway::health::asleep)
                             {
                                 _inf_ << "suspend " << pier.first << ":" << serv.name;
@@ -833,22 +1351,19 @@ namespace slipway
                     }
                 }
 
-                std::swap(m_pool, pool);
-                for (auto& item : pool)
-                {
-                    auto iter = m_pool.find(item.first);
-                    if (iter == m_pool.end())
-                        _inf_ << "remove " << item.first.pier << ":" << item.first.service;
-                }
+                retain(live);
             }
 
             void unplug(const slipway::handle& id) noexcept(false)
             {
                 quard lock(m_home / webpier_lock_file_name);
 
-                webpier::config conf = load_config();
-                webpier::service serv = load_config(conf.repo, id);
+                auto conf = load_config();
+                unplug(conf, id, load_config(conf->repo, id));
+            }
 
+            void unplug(const config_ptr& conf, const slipway::handle& id, const webpier::service& serv) noexcept(false)
+            {
                 auto iter = m_pool.find(id);
                 if (serv.name.empty())
                 {
@@ -875,6 +1390,9 @@ namespace slipway
                 std::vector<slipway::health> res;
                 for (auto& item : m_pool)
                     res.emplace_back(report::health{ item.first, item.second->state(), item.second->message() });
+
+                // the pool is kept in the interning order, but the full list is reported sorted by the handles
+                std::sort(res.begin(), res.end(), [](const slipway::handle& a, const slipway::handle& b) { return a < b; });
                 return res;
             }
 
@@ -892,6 +1410,8 @@ namespace slipway
                 std::vector<slipway::report> res;
                 for (auto& item : m_pool)
                     res.emplace_back(slipway::report{ slipway::health{ item.first, item.second->state(), item.second->message() }, item.second->tunnels() });
+
+                std::sort(res.begin(), res.end(), [](const slipway::handle& a, const slipway::handle& b) { return a < b; });
                 return res;
             }
 
@@ -904,31 +1424,212 @@ namespace slipway
                 throw std::runtime_error("unknown service");
             }
 
+            uint64_t stamp() noexcept(true)
+            {
+                // the counter starts from the launch time, so the stamps of the previous process don't match
+                uint64_t res = *m_generation;
+                return res ? res : 1;
+            }
+
+            slipway::digest digest(const slipway::query& filter, uint8_t fields) noexcept(false)
+            {
+                slipway::digest res;
+                res.stamp = stamp();
+                res.fields = filter.fields & fields;
+
+                if (filter.since == res.stamp)
+                {
+                    res.changed = false;
+                    return res;
+                }
+
+                auto iter = filter.after.pier.empty() && filter.after.service.empty()
+                    ? m_pool.begin()
+                    : m_pool.next(filter.after);
+
+                for (; iter != m_pool.end(); ++iter)
+                {
+                    if (!filter.pier.empty() && iter->first.pier != filter.pier)
+                        continue;
+
+                    if ((filter.side == slipway::query::exports && iter->first.pier != m_host) || (filter.side == slipway::query::imports && iter->first.pier == m_host))
+                        continue;
+
+                    auto state = iter->second->state();
+                    if (filter.states && (filter.states & (1 << state)) == 0)
+                        continue;
+
+                    if (filter.limit && res.items.size() == filter.limit)
+                    {
+                        res.more = true;
+                        break;
+                    }
+
+                    slipway::report item { slipway::health { iter->first, state, "" }, {} };
+                    if (res.fields & slipway::query::message)
+                        item.message = iter->second->message();
+                    if (res.fields & slipway::query::tunnels)
+                        item.tunnels = iter->second->tunnels();
+
+                    res.items.emplace_back(std::move(item));
+                }
+                return res;
+            }
+
+            std::vector<slipway::handle> select(const std::vector<slipway::handle>& list, const std::map<std::string, std::vector<webpier::service>>& piers = {}) noexcept(true)
+            {
+                std::set<slipway::handle> res;
+                for (const auto& id : list)
+                {
+                    if (!id.service.empty())
+                    {
+                        res.insert(id);
+                        continue;
+                    }
+
+                    auto iter = piers.find(id.pier);
+                    if (iter != piers.end())
+                    {
+                        for (const auto& serv : iter->second)
+                            res.insert(slipway::handle { id.pier, serv.name });
+                    }
+
+                    for (const auto& item : m_pool)
+                    {
+                        if (item.first.pier == id.pier)
+                            res.insert(item.first);
+                    }
+                }
+                return std::vector<slipway::handle>(res.begin(), res.end());
+            }
+
+            template<class action>
+            std::vector<slipway::health> perform(const std::vector<slipway::handle>& list, action func) noexcept(false)
+            {
+                quard lock(m_home / webpier_lock_file_name);
+
+                auto conf = load_config();
+                auto piers = load_config(conf->repo);
+
+                std::vector<slipway::health> res;
+                for (const auto& id : select(list, piers))
+                {
+                    webpier::service serv;
+
+                    auto pier = piers.find(id.pier);
+                    if (pier != piers.end())
+                    {
+                        auto iter = std::find_if(pier->second.begin(), pier->second.end(), [&id](const webpier::service& item)
+                        {
+                            return item.name == id.service;
+                        });
+
+                        if (iter != pier->second.end())
+                            serv = *iter;
+                    }
+
+                    try
+                    {
+                        func(conf, id, serv);
+                        res.emplace_back(status(id));
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        res.emplace_back(slipway::health { id, slipway::health::asleep, ex.what() });
+                    }
+                }
+                return res;
+            }
+
+            std::vector<slipway::health> unplug(const std::vector<slipway::handle>& list) noexcept(false)
+            {
+                return perform(list, [this](const config_ptr& conf, const slipway::handle& id, const webpier::service& serv)
+                {
+                    unplug(conf, id, serv);
+                });
+            }
+
+            std::vector<slipway::health> engage(const std::vector<slipway::handle>& list) noexcept(false)
+            {
+                return perform(list, [this](const config_ptr& conf, const slipway::handle& id, const webpier::service& serv)
+                {
+                    engage(conf, id, serv);
+                });
+            }
+
+            std::vector<slipway::health> adjust(const std::vector<slipway::handle>& list) noexcept(false)
+            {
+                return perform(list, [this](const config_ptr& conf, const slipway::handle& id, const webpier::service& serv)
+                {
+                    adjust(conf, id, serv);
+                });
+            }
+
+            std::vector<slipway::health> status(const std::vector<slipway::handle>& list) noexcept(true)
+            {
+                std::vector<slipway::health> res;
+                for (const auto& id : select(list))
+                {
+                    auto iter = m_pool.find(id);
+                    res.emplace_back(iter != m_pool.end()
+                        ? slipway::health { id, iter->second->state(), iter->second->message() }
+                        : slipway::health { id, slipway::health::asleep, "unknown service" });
+                }
+                return res;
+            }
+
+            std::vector<slipway::report> report(const std::vector<slipway::handle>& list) noexcept(true)
+            {
+                std::vector<slipway::report> res;
+                for (const auto& id : select(list))
+                {
+                    auto iter = m_pool.find(id);
+                    res.emplace_back(iter != m_pool.end()
+                        ? slipway::report { slipway::health { id, iter->second->state(), iter->second->message() }, iter->second->tunnels() }
+                        : slipway::report { slipway::health { id, slipway::health::asleep, "unknown service" }, {} });
+                }
+                return res;
+            }
+
         public:
 
             engine(boost::asio::io_context& io, const std::filesystem::path& home)
                 : m_io(io)
                 , m_home(home)
+                , m_collector(std::make_shared<collector>())
+                , m_generation(std::make_shared<std::atomic<uint64_t>>(std::chrono::system_clock::now().time_since_epoch().count()))
+                , m_delay(io)
+                , m_stopped(false)
             {
             }
 
             void launch() noexcept(false)
             {
+                // the stamps are taken before the files are read, a change in between is found by the next reload
+                seed();
                 engage();
+                watch();
             }
 
             void finish() noexcept(false)
             {
+                m_stopped = true;
+                m_watchers.clear();
+
+                boost::system::error_code ec;
+                m_delay.cancel(ec);
+
                 unplug();
             }
 
-            void comply(boost::asio::streambuf& request) noexcept(true)
+            void comply(boost::asio::streambuf& request, boost::asio::streambuf& response, slipway::codec& format) noexcept(true)
             {
                 slipway::message req, res;
+                slipway::codec next = format;
 
                 try
                 {
-                    slipway::pull_message(request, req);
+                    slipway::pull_message(request, req, format);
 
                     _trc_ << "handle request: action=" << req.action << " payload=" << req.payload.index();
 
@@ -936,6 +1637,12 @@ namespace slipway
                     {
                         case slipway::message::unplug:
                         {
+                            if (req.payload.index() == 7)
+                            {
+                                res = slipway::message::make(slipway::message::unplug, unplug(std::get<std::vector<slipway::handle>>(req.payload)));
+                                break;
+                            }
+
                             req.payload.index() == 1 
                                 ? unplug(std::get<slipway::handle>(req.payload)) 
                                 : unplug();
@@ -944,6 +1651,12 @@ namespace slipway
                         }
                         case slipway::message::engage:
                         {
+                            if (req.payload.index() == 7)
+                            {
+                                res = slipway::message::make(slipway::message::engage, engage(std::get<std::vector<slipway::handle>>(req.payload)));
+                                break;
+                            }
+
                             req.payload.index() == 1 
                                 ? engage(std::get<slipway::handle>(req.payload)) 
                                 : engage();
@@ -952,6 +1665,12 @@ namespace slipway
                         }
                         case slipway::message::adjust:
                         {
+                            if (req.payload.index() == 7)
+                            {
+                                res = slipway::message::make(slipway::message::adjust, adjust(std::get<std::vector<slipway::handle>>(req.payload)));
+                                break;
+                            }
+
                             req.payload.index() == 1 
                                 ? adjust(std::get<slipway::handle>(req.payload)) 
                                 : adjust();
@@ -962,14 +1681,29 @@ namespace slipway
                         {
                             res = req.payload.index() == 1
                                 ? slipway::message::make(slipway::message::status, status(std::get<slipway::handle>(req.payload)))
-                                : slipway::message::make(slipway::message::status, status());
+                                : req.payload.index() == 7
+                                    ? slipway::message::make(slipway::message::status, status(std::get<std::vector<slipway::handle>>(req.payload)))
+                                    : req.payload.index() == 8
+                                        ? slipway::message::make(slipway::message::status, digest(std::get<slipway::query>(req.payload), slipway::query::state | slipway::query::message))
+                                        : slipway::message::make(slipway::message::status, status());
                             break;
                         }
                         case slipway::message::review:
                         {
                             res = req.payload.index() == 1
                                 ? slipway::message::make(slipway::message::review, report(std::get<slipway::handle>(req.payload)))
-                                : slipway::message::make(slipway::message::review, report());
+                                : req.payload.index() == 7
+                                    ? slipway::message::make(slipway::message::review, report(std::get<std::vector<slipway::handle>>(req.payload)))
+                                    : req.payload.index() == 8
+                                        ? slipway::message::make(slipway::message::review, digest(std::get<slipway::query>(req.payload), slipway::query::state | slipway::query::message | slipway::query::tunnels))
+                                        : slipway::message::make(slipway::message::review, report());
+                            break;
+                        }
+                        case slipway::message::accord:
+                        {
+                            auto version = std::min(std::get<uint32_t>(req.payload), slipway::message_version);
+                            res = slipway::message::make(slipway::message::accord, version);
+                            next = version > 0 ? slipway::binary : slipway::json;
                             break;
                         }
                         default:
@@ -983,7 +1717,22 @@ namespace slipway
                     res = slipway::message::make(req.action, ex.what());
                 }
 
-                slipway::push_message(request, res);
+                res.id = req.id;
+
+                try
+                {
+                    slipway::push_message(response, res, format);
+                }
+                catch (const std::exception& ex)
+                {
+                    _err_ << ex.what();
+
+                    res = slipway::message::make(req.action, ex.what());
+                    res.id = req.id;
+                    slipway::push_message(response, res, format);
+                }
+
+                format = next;
             }
         };
 
@@ -999,7 +1748,9 @@ namespace slipway
             {
                 boost::asio::spawn(m_io, [this, socket = std::move(client)](boost::asio::yield_context yield) mutable
                 {
-                    boost::asio::streambuf buffer;
+                    boost::asio::streambuf input(slipway::max_message_size);
+                    boost::asio::streambuf output;
+                    slipway::codec format = slipway::json;
                     boost::system::error_code ec;
 
                     auto cleanup = [&]()
@@ -1016,17 +1767,18 @@ namespace slipway
                         ec = socket.close(ec);
                     };
 
-                    boost::asio::async_read_until(socket, buffer, '\n', yield[ec]);
-                    if (ec)
-                        return cleanup();
-
-                    m_engine.comply(buffer);
+                    while (true)
+                    {
+                        boost::asio::async_read_until(socket, input, slipway::frame(format), yield[ec]);
+                        if (ec)
+                            return cleanup();
 
-                    boost::asio::async_write(socket, buffer, yield[ec]);
-                    if (ec)
-                        return cleanup();
+                        m_engine.comply(input, output, format);
 
-                    handle(std::move(socket));
+                        boost::asio::async_write(socket, output, yield[ec]);
+                        if (ec)
+                            return cleanup();
+                    }
                 }, boost::asio::detached);
             }
 
@@ -12,6 +12,97 @@
 #include <wormhole/wormhole.h>
 #include <wormhole/logger.h>
 #include <boost/program_options.hpp>
+#include <condition_variable>
+#include <algorithm>
+#include <thread>
+
+#ifdef __GLIBC__
+    #include <malloc.h>
+#endif
+
+namespace {
+
+#ifdef __GLIBC__
+class heap_keeper
+{
+    static constexpr size_t trim_threshold = 4 * 1024 * 1024;
+    static constexpr size_t report_period = 60;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+    size_t m_peak = 0;
+    size_t m_reported = 0;
+    size_t m_ticks = 0;
+    bool m_stop = false;
+
+    void check() noexcept(true)
+    {
+#if __GLIBC_PREREQ(2, 33)
+        auto info = ::mallinfo2();
+        size_t arena = info.arena;
+        size_t mapped = info.hblkhd;
+        size_t busy = info.uordblks;
+        size_t idle = info.fordblks;
+#else
+        // the older counters are int, so they wrap beyond 4 GiB which is far above the tunnel heap
+        auto info = ::mallinfo();
+        size_t arena = static_cast<unsigned int>(info.arena);
+        size_t mapped = static_cast<unsigned int>(info.hblkhd);
+        size_t busy = static_cast<unsigned int>(info.uordblks);
+        size_t idle = static_cast<unsigned int>(info.fordblks);
+#endif
+        // the heap is sampled every second to catch the peak, but it is reported once a period at most
+        size_t used = busy + mapped;
+        m_peak = std::max(m_peak, used);
+
+        if (++m_ticks % report_period == 0)
+        {
+            if (m_peak > m_reported)
+            {
+                m_reported = m_peak;
+                _inf_ << "heap high-water mark is " << m_peak << " bytes, arena=" << arena << " mmap=" << mapped;
+            }
+            _dbg_ << "heap used=" << used << " free=" << idle << " peak=" << m_peak;
+        }
+
+        // the freed chunks inside the heap are not given back by the automatic trimming of its top
+        if (idle > trim_threshold)
+            ::malloc_trim(0);
+    }
+
+public:
+
+    heap_keeper()
+    {
+        // the data path runs on the io thread only and the keeper thread allocates just for its rare log lines,
+        // so the extra arenas would hold the freed buffers and fragment the heap
+        ::mallopt(M_ARENA_MAX, 1);
+        // the fixed thresholds turn off the dynamic adjustment which lets the freed buffers pile up
+        ::mallopt(M_MMAP_THRESHOLD, 128 * 1024);
+        ::mallopt(M_TRIM_THRESHOLD, 256 * 1024);
+
+        m_thread = std::thread([this]()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_cond.wait_for(lock, std::chrono::seconds(1), [this]() { return m_stop; }))
+                check();
+        });
+    }
+
+    ~heap_keeper()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_thread.join();
+    }
+};
+#endif
+
+}
 
 int main(int argc, char *argv[])
 {
@@ -21,6 +112,14 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+#ifdef BOOST_ASIO_HAS_IO_URING
+    if (!webpier::verify_io_uring())
+    {
+        std::cerr << "io_uring is not supported" << std::endl;
+        return 1;
+    }
+#endif
+
     boost::program_options::options_description base("command line options", 160, 60);
     base.add_options()
         ("purpose,p", boost::program_options::value<std::string>()->required())
@@ -36,7 +135,8 @@ int main(int argc, char *argv[])
         ("secret", boost::program_options::value<uint64_t>()->default_value(0))
         ("cert", boost::program_options::value<std::string>()->default_value(""))
         ("key", boost::program_options::value<std::string>()->default_value(""))
-        ("ca", boost::program_options::value<std::string>()->default_value(""));
+        ("ca", boost::program_options::value<std::string>()->default_value(""))
+        ("ktls", boost::program_options::value<bool>()->default_value(true));
 
     boost::program_options::variables_map vm;
     try
@@ -47,7 +147,8 @@ int main(int argc, char *argv[])
             return env == "WORMHOLE_SECRET" ? "secret" : 
                    env == "WORMHOLE_CERT" ? "cert" : 
                    env == "WORMHOLE_KEY" ? "key" : 
-                   env == "WORMHOLE_CA" ? "ca" : "";
+                   env == "WORMHOLE_CA" ? "ca" : 
+                   env == "WEBPIER_KTLS" ? "ktls" : "";
         };
 
         boost::program_options::store(boost::program_options::parse_environment(more, mapper), vm);
@@ -63,6 +164,10 @@ int main(int argc, char *argv[])
     {
         wormhole::log::set(vm["logging"].as<wormhole::log::severity>(), vm["journal"].as<std::string>());
 
+#ifdef __GLIBC__
+        heap_keeper keeper;
+#endif
+
         auto purpose = vm["purpose"].as<std::string>();
         auto service = vm["service"].as<wormhole::endpoint>();
         auto gateway = vm["gateway"].as<wormhole::endpoint>();
@@ -78,6 +183,18 @@ int main(int argc, char *argv[])
             }
         };
 
+        if (vm["ktls"].as<bool>())
+        {
+            try
+            {
+                webpier::enable_kernel_tls();
+            }
+            catch (const std::exception& e)
+            {
+                _wrn_ << "can't enable kernel TLS: " << e.what();
+            }
+        }
+
         _inf_ << "starting tunnel for purpose=" << purpose << " service=" << service << " gateway=" << gateway << " faraway=" << faraway << " quality=" << quality;
 
         boost::asio::io_context io;
@@ -1,7 +1,10 @@
 #include <store/context.h>
+#include <store/index.h>
 #include <store/utils.h>
 #include <map>
+#include <set>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
@@ -39,14 +42,28 @@ namespace webpier
                 return boost::interprocess::file_lock(file.string().c_str());
             }
 
+            friend struct read_lock;
             friend struct soft_lock;
             friend struct hard_lock;
+            friend struct sync_lock;
 
             std::filesystem::path           m_file;
             boost::interprocess::file_lock  m_lock;
             std::filesystem::file_time_type m_time;
         };
 
+        struct read_lock
+        {
+            read_lock(locker& guard) 
+                : m_lock(guard.m_lock)
+            {
+            }
+
+        private:
+
+            boost::interprocess::scoped_lock<boost::interprocess::file_lock> m_lock;
+        };
+
         struct soft_lock
         {
             soft_lock(locker& guard) 
@@ -73,6 +90,8 @@ namespace webpier
 
             ~hard_lock()
             {
+                // reopening for writing lets the watchers see the change even where the attribute events are missed
+                std::ofstream(m_guard.m_file, std::ios::app).close();
                 m_guard.m_time = std::filesystem::file_time_type::clock::now();
                 std::filesystem::last_write_time(m_guard.m_file, m_guard.m_time);
             }
@@ -82,13 +101,79 @@ namespace webpier
             locker& m_guard;
         };
 
+        struct sync_lock
+        {
+            sync_lock(locker& guard) 
+                : m_guard(guard)
+                , m_lock(guard.m_lock)
+            {
+            }
+
+            bool stale() const
+            {
+                return m_guard.m_time == std::filesystem::file_time_type() || m_guard.m_time != std::filesystem::last_write_time(m_guard.m_file);
+            }
+
+            void renew()
+            {
+                m_guard.m_time = std::filesystem::last_write_time(m_guard.m_file);
+            }
+
+        private:
+
+            locker& m_guard;
+            boost::interprocess::scoped_lock<boost::interprocess::file_lock> m_lock;
+        };
+
         class context_impl : public context
         {
             using bundle = std::map<std::string, std::map<std::string, service>>;
 
+            struct x509_info
+            {
+                std::filesystem::file_time_type time;
+                std::uintmax_t size;
+                std::string cert;
+                std::string sha1;
+            };
+
+            using x509_cache = std::map<std::string, x509_info>;
+
+            struct batch
+            {
+                bundle origin;
+                std::set<std::string> dirty;
+                std::set<std::string> drops;
+                std::map<std::string, std::string> certs;
+            };
+
             config m_config;
             bundle m_bundle;
+            std::map<std::string, size_t> m_usage;
             mutable locker m_guard;
+            mutable x509_cache m_x509;
+            std::unique_ptr<batch> m_batch;
+            std::map<std::string, stamp> m_stamps;
+            stamp m_index;
+            stamp m_conf;
+
+            const x509_info& fetch_x509_info(const std::string& pier) const noexcept(false)
+            {
+                auto path = std::filesystem::path(m_config.repo) / pier / cert_file_name;
+
+                std::error_code ec;
+                auto time = std::filesystem::last_write_time(path, ec);
+                auto size = ec ? 0 : std::filesystem::file_size(path, ec);
+
+                auto iter = m_x509.find(pier);
+                if (ec || iter == m_x509.end() || iter->second.time != time || iter->second.size != size)
+                {
+                    m_x509.erase(pier);
+                    iter = m_x509.emplace(pier, x509_info { time, size, load_x509_cert(path), get_x509_public_sha1(path) }).first;
+                }
+
+                return iter->second;
+            }
 
             void load_config() noexcept(false)
             {
@@ -103,6 +188,7 @@ namespace webpier
                         m_config.repo = utf8_to_locale(doc.get<std::string>("repo"));
                         m_config.log.folder = utf8_to_locale(doc.get<std::string>("log.folder", ""));
                         m_config.log.level = doc.get<wormhole::log::severity>("log.level", wormhole::log::info);
+                        m_config.log.merge = doc.get<bool>("log.merge", false);
                         m_config.nat.udp_stun = utf8_to_locale(doc.get<std::string>("nat.stun.udp", doc.get<std::string>("nat.stun", default_udp_stun_server)));
                         m_config.nat.tcp_stun = utf8_to_locale(doc.get<std::string>("nat.stun.tcp", default_tcp_stun_server));
                         m_config.nat.test = doc.get<plexus::checkup>("nat.test", plexus::checkup::strict);
@@ -121,6 +207,7 @@ namespace webpier
                         m_config.relay.key = utf8_to_locale(doc.get<std::string>("relay.key", ""));
                         m_config.relay.ca = utf8_to_locale(doc.get<std::string>("relay.ca", ""));
                     }
+                    m_conf = stamp(file);
                 }
                 catch(const std::exception& e)
                 {
@@ -139,6 +226,7 @@ namespace webpier
                     doc.put("repo", locale_to_utf8(m_config.repo));
                     doc.put("log.folder", locale_to_utf8(m_config.log.folder));
                     doc.put("log.level", static_cast<int>(m_config.log.level));
+                    doc.put("log.merge", m_config.log.merge);
                     doc.put("nat.stun.udp", locale_to_utf8(m_config.nat.udp_stun));
                     doc.put("nat.stun.tcp", locale_to_utf8(m_config.nat.tcp_stun));
                     doc.put("nat.test", m_config.nat.test);
@@ -157,6 +245,7 @@ namespace webpier
                     doc.put("relay.key", locale_to_utf8(m_config.relay.key));
                     doc.put("relay.ca", locale_to_utf8(m_config.relay.ca));
                     boost::property_tree::write_json(file.string(), doc);
+                    m_conf = stamp(file);
                 }
                 catch(const std::exception& e)
                 {
@@ -166,74 +255,131 @@ namespace webpier
 
             void load_pier_config(const std::string& id) noexcept(false)
             {
+                auto& services = m_bundle[id];
+
+                std::vector<service> list;
+                load_pier_services(m_config.repo, id, id == m_config.pier, list);
+                m_stamps[id] = stamp(std::filesystem::path(m_config.repo) / id / conf_file_name);
+
+                for (auto& unit : list)
+                    services.emplace(unit.name, unit);
+            }
+
+            void save_pier_config(const std::string& id) noexcept(false)
+            {
+                if (exists_index(m_config.repo))
+                {
+                    catalog data;
+                    for (auto& pier : m_bundle)
+                    {
+                        auto& list = data[pier.first];
+                        for (auto& unit : pier.second)
+                            list.push_back(unit.second);
+                    }
+
+                    save_index(m_config.repo, data);
+                    m_index = stamp(std::filesystem::path(m_config.repo) / index_file_name);
+                    return;
+                }
+
+                std::vector<service> list;
+                for (auto& unit : m_bundle[id])
+                    list.push_back(unit.second);
+
+                save_pier_services(m_config.repo, id, list);
+                m_stamps[id] = stamp(std::filesystem::path(m_config.repo) / id / conf_file_name);
+            }
+
+            // the pier services are restored from the origin if they can't be written, the transaction keeps its own origin
+            void persist(const std::string& id, const bundle::mapped_type& origin) noexcept(false)
+            {
+                if (m_batch)
+                {
+                    m_batch->dirty.insert(id);
+                    return;
+                }
+
                 try
                 {
-                    auto& services = m_bundle[id];
+                    hard_lock lock(m_guard);
+                    save_pier_config(id);
+                }
+                catch (...)
+                {
+                    m_bundle[id] = origin;
+                    reindex();
+                    throw;
+                }
+            }
 
-                    auto file = std::filesystem::path(m_config.repo) / id / conf_file_name;
-                    if (std::filesystem::exists(file))
+            std::vector<std::string> list_piers() const noexcept(false)
+            {
+                std::vector<std::string> res;
+                if (std::filesystem::exists(m_config.repo))
+                {
+                    for (auto const& owner : std::filesystem::directory_iterator(m_config.repo))
                     {
-                        boost::property_tree::ptree doc;
-                        boost::property_tree::read_json(file.string(), doc);
+                        if (!owner.is_directory())
+                            continue;
 
-                        boost::property_tree::ptree array;
-                        for (auto& item : doc.get_child("services", array))
+                        for (auto const& pin : std::filesystem::directory_iterator(owner.path()))
                         {
-                            service unit;
-                            unit.local = item.second.get<bool>("local", id == m_config.pier);
-                            unit.name = utf8_to_locale(item.second.get<std::string>("name", ""));
-                            unit.pier = utf8_to_locale(item.second.get<std::string>("pier", ""));
-                            unit.address = utf8_to_locale(item.second.get<std::string>("address", ""));
-                            unit.gateway = utf8_to_locale(item.second.get<std::string>("gateway", default_ip4_gateway));
-                            unit.rendezvous = utf8_to_locale(item.second.get<std::string>("rendezvous", ""));
-                            unit.proto = wormhole::protocol(item.second.get<int>("proto", wormhole::protocol::udp));
-                            unit.role = wormhole::schema(item.second.get<int>("role", wormhole::schema::either));
-                            unit.route = plexus::routing::favour(item.second.get<int>("route", plexus::routing::direct));
-                            unit.autostart = item.second.get<bool>("autostart", false);
-                            unit.obscure = item.second.get<bool>("obscure", true);
-                            services.emplace(unit.name, unit);
+                            if (!pin.is_directory())
+                                continue;
+
+                            if (!std::filesystem::exists(pin.path() / cert_file_name))
+                                continue;
+
+                            res.push_back(owner.path().filename().string() + "/" + pin.path().filename().string());
                         }
                     }
                 }
-                catch(const std::exception& e)
-                {
-                    throw file_error(e.what());
-                }
+                return res;
             }
 
-            void save_pier_config(const std::string& id) noexcept(false)
+            void load_piers() noexcept(false)
             {
-                try
+                if (exists_index(m_config.repo))
                 {
-                    auto file = std::filesystem::path(m_config.repo) / id / conf_file_name;
-                    auto& services = m_bundle[id];
+                    catalog data;
+                    load_index(m_config.repo, data);
+                    m_index = stamp(std::filesystem::path(m_config.repo) / index_file_name);
 
-                    boost::property_tree::ptree array;
-                    for (auto& unit : services)
+                    for (auto& pier : data)
                     {
-                        boost::property_tree::ptree item;
-                        item.put("local", unit.second.local);
-                        item.put("name", locale_to_utf8(unit.second.name));
-                        item.put("pier", locale_to_utf8(unit.second.pier));
-                        item.put("address", locale_to_utf8(unit.second.address));
-                        item.put("gateway", locale_to_utf8(unit.second.gateway));
-                        item.put("rendezvous", locale_to_utf8(unit.second.rendezvous));
-                        item.put("proto", static_cast<int>(unit.second.proto));
-                        item.put("role", static_cast<int>(unit.second.role));
-                        item.put("route", static_cast<int>(unit.second.route));
-                        item.put("autostart", unit.second.autostart);
-                        item.put("obscure", unit.second.obscure);
-                        array.push_back(std::make_pair("", item));
+                        auto& services = m_bundle[pier.first];
+                        for (auto& unit : pier.second)
+                            services.emplace(unit.name, unit);
                     }
+                }
+                else
+                {
+                    for (const auto& id : list_piers())
+                        load_pier_config(id);
+                }
 
-                    boost::property_tree::ptree doc;
-                    doc.put_child("services", array);
+                reindex();
+            }
 
-                    boost::property_tree::write_json(file.string(), doc);
-                }
-                catch(const std::exception& e)
+            void reindex() noexcept(true)
+            {
+                m_usage.clear();
+                for (auto& pier : m_bundle)
                 {
-                    throw file_error(e.what());
+                    for (auto& unit : pier.second)
+                    {
+                        if (unit.second.local)
+                        {
+                            std::istringstream stream(unit.second.pier);
+                            std::string peer;
+                            while (stream >> peer)
+                                ++m_usage[peer];
+                        }
+                        else
+                        {
+                            ++m_usage[unit.second.pier];
+                        }
+                    }
                 }
             }
 
@@ -247,27 +393,7 @@ namespace webpier
                 if (std::filesystem::exists(home / conf_file_name))
                 {
                     load_config();
-
-                    if (std::filesystem::exists(m_config.repo))
-                    {
-                        for (auto const& owner : std::filesystem::directory_iterator(m_config.repo))
-                        {
-                            if (!owner.is_directory())
-                                continue;
-
-                            for (auto const& pin : std::filesystem::directory_iterator(owner.path()))
-                            {
-                                if (!pin.is_directory())
-                                    continue;
-
-                                if (!std::filesystem::exists(pin.path() / cert_file_name))
-                                    continue;
-
-                                auto id = owner.path().filename().string() + "/" + pin.path().filename().string();
-                                load_pier_config(id);
-                            }
-                        }
-                    }
+                    load_piers();
                 }
             }
 
@@ -288,6 +414,9 @@ namespace webpier
 
             void set_config(const config& info) noexcept(false) override
             {
+                if (m_batch)
+                    throw usage_error("Can't change the config in the transaction");
+
                 if (info.pier != m_config.pier)
                 {
                     auto home = std::filesystem::path(info.repo) / info.pier;
@@ -300,11 +429,12 @@ namespace webpier
                     if (wrong)
                         throw usage_error("Wrong local pier");
 
+                    hard_lock lock(m_guard);
+
                     m_config = info;
                     m_bundle.clear();
                     m_bundle.emplace(m_config.pier, bundle::mapped_type());
-
-                    hard_lock lock(m_guard);
+                    m_x509.clear();
 
                     std::filesystem::create_directories(m_config.repo);
 
@@ -319,34 +449,24 @@ namespace webpier
                     }
 
                     save_config();
-
-                    if (std::filesystem::exists(m_config.repo))
-                    {
-                        for (auto const& owner : std::filesystem::directory_iterator(m_config.repo))
-                        {
-                            if (!owner.is_directory())
-                                continue;
-
-                            for (auto const& pin : std::filesystem::directory_iterator(owner.path()))
-                            {
-                                if (!pin.is_directory())
-                                    continue;
-
-                                if (!std::filesystem::exists(pin.path() / cert_file_name))
-                                    continue;
-
-                                auto id = owner.path().filename().string() + "/" + pin.path().filename().string();
-                                load_pier_config(id);
-                            }
-                        }
-                    }
+                    load_piers();
                 }
                 else
                 {
+                    hard_lock lock(m_guard);
+
+                    auto origin = m_config;
                     m_config = info;
 
-                    hard_lock lock(m_guard);
-                    save_config();
+                    try
+                    {
+                        save_config();
+                    }
+                    catch (...)
+                    {
+                        m_config = origin;
+                        throw;
+                    }
                 }
             }
 
@@ -384,10 +504,10 @@ namespace webpier
                 if (iter->second.find(info.name) != iter->second.end())
                     throw usage_error("Such service already exists");
 
+                auto origin = iter->second;
                 iter->second.emplace(info.name, info);
-
-                hard_lock lock(m_guard);
-                save_pier_config(m_config.pier);
+                reindex();
+                persist(m_config.pier, origin);
             }
 
             void del_export_service(const std::string& name) noexcept(false) override
@@ -396,10 +516,11 @@ namespace webpier
                 if (iter == m_bundle.end())
                     throw usage_error("There is no such local pier");
 
+                auto origin = iter->second;
                 if (iter->second.erase(name))
                 {
-                    hard_lock lock(m_guard);
-                    save_pier_config(m_config.pier);
+                    reindex();
+                    persist(m_config.pier, origin);
                 }
             }
 
@@ -415,10 +536,10 @@ namespace webpier
                 if (iter->second.find(info.name) != iter->second.end())
                     throw usage_error("Such service already exists");
 
+                auto origin = iter->second;
                 iter->second.emplace(info.name, info);
-
-                hard_lock lock(m_guard);
-                save_pier_config(info.pier);
+                reindex();
+                persist(info.pier, origin);
             }
 
             void del_import_service(const std::string& pier, const std::string& name) noexcept(false) override
@@ -427,10 +548,11 @@ namespace webpier
                 if (iter == m_bundle.end())
                     throw usage_error("There is no such remote pier");
 
+                auto origin = iter->second;
                 if (iter->second.erase(name))
                 {
-                    hard_lock lock(m_guard);
-                    save_pier_config(pier);
+                    reindex();
+                    persist(pier, origin);
                 }
             }
 
@@ -445,10 +567,21 @@ namespace webpier
 
             void add_pier(const std::string& pier, const std::string& cert) noexcept(false) override
             {
-                hard_lock lock(m_guard);
-
                 auto path = std::filesystem::path(m_config.repo) / pier;
 
+                if (m_batch)
+                {
+                    if (m_bundle.find(pier) != m_bundle.end() || (std::filesystem::exists(path) && m_batch->drops.count(pier) == 0))
+                        throw usage_error("The pier already exists");
+
+                    m_batch->certs[pier] = cert;
+                    m_batch->dirty.insert(pier);
+                    m_bundle.emplace(pier, bundle::mapped_type());
+                    return;
+                }
+
+                hard_lock lock(m_guard);
+
                 if (std::filesystem::exists(path))
                     throw usage_error("The pier already exists");
 
@@ -456,6 +589,9 @@ namespace webpier
                 save_x509_cert(path / cert_file_name, cert);
 
                 m_bundle.emplace(pier, bundle::mapped_type());
+
+                if (exists_index(m_config.repo))
+                    save_pier_config(pier);
             }
 
             void del_pier(const std::string& pier) noexcept(false) override
@@ -463,8 +599,38 @@ namespace webpier
                 if (m_config.pier == pier)
                     throw usage_error("Can't delete local pier");
 
+                if (m_batch)
+                {
+                    m_bundle.erase(pier);
+                    m_x509.erase(pier);
+                    reindex();
+
+                    m_batch->drops.insert(pier);
+                    m_batch->certs.erase(pier);
+                    m_batch->dirty.erase(pier);
+                    return;
+                }
+
                 hard_lock lock(m_guard);
-                m_bundle.erase(pier);
+
+                auto origin = m_bundle.extract(pier);
+                m_x509.erase(pier);
+                reindex();
+
+                if (exists_index(m_config.repo))
+                {
+                    try
+                    {
+                        save_pier_config(pier);
+                    }
+                    catch (...)
+                    {
+                        if (origin)
+                            m_bundle.insert(std::move(origin));
+                        reindex();
+                        throw;
+                    }
+                }
 
                 try
                 {
@@ -476,16 +642,313 @@ namespace webpier
                 }
             }
 
-            std::string get_fingerprint(const std::string& pier) const noexcept(false) override
+            std::vector<std::string> refresh() noexcept(false) override
             {
+                if (m_batch)
+                    throw usage_error("Can't refresh the context in the transaction");
+
+                sync_lock lock(m_guard);
+
+                if (!lock.stale())
+                    return {};
+
+                std::set<std::string> changed;
+                auto origin = m_config;
+
+                if (!(m_conf == stamp(m_guard.home() / conf_file_name)))
+                    load_config();
+
+                if (origin.pier != m_config.pier || origin.repo != m_config.repo)
+                {
+                    for (const auto& pier : m_bundle)
+                        changed.insert(pier.first);
+
+                    m_bundle.clear();
+                    m_stamps.clear();
+                    load_piers();
+
+                    for (const auto& pier : m_bundle)
+                        changed.insert(pier.first);
+                }
+                else if (exists_index(m_config.repo))
+                {
+                    if (!(m_index == stamp(std::filesystem::path(m_config.repo) / index_file_name)))
+                    {
+                        auto before = std::move(m_bundle);
+                        m_bundle.clear();
+                        load_piers();
+
+                        for (const auto& pier : before)
+                        {
+                            auto iter = m_bundle.find(pier.first);
+                            if (iter == m_bundle.end() || iter->second != pier.second)
+                                changed.insert(pier.first);
+                        }
+
+                        for (const auto& pier : m_bundle)
+                        {
+                            if (before.find(pier.first) == before.end())
+                                changed.insert(pier.first);
+                        }
+                    }
+                }
+                else
+                {
+                    std::set<std::string> piers;
+                    for (const auto& id : list_piers())
+                    {
+                        piers.insert(id);
+
+                        auto last = m_stamps.find(id);
+                        if (last != m_stamps.end() && last->second == stamp(std::filesystem::path(m_config.repo) / id / conf_file_name))
+                            continue;
+
+                        auto iter = m_bundle.find(id);
+                        auto before = iter != m_bundle.end() ? std::move(iter->second) : bundle::mapped_type();
+                        bool fresh = iter == m_bundle.end();
+
+                        m_bundle.erase(id);
+                        load_pier_config(id);
+
+                        if (fresh || m_bundle[id] != before)
+                            changed.insert(id);
+                    }
+
+                    auto iter = m_bundle.begin();
+                    while (iter != m_bundle.end())
+                    {
+                        if (piers.count(iter->first) == 0 && iter->first != m_config.pier)
+                        {
+                            changed.insert(iter->first);
+                            m_stamps.erase(iter->first);
+                            iter = m_bundle.erase(iter);
+                        }
+                        else
+                            ++iter;
+                    }
+                }
+
+                for (const auto& pier : changed)
+                    m_x509.erase(pier);
+
+                reindex();
+                lock.renew();
+
+                return std::vector<std::string>(changed.begin(), changed.end());
+            }
+
+            void pack() noexcept(false) override
+            {
+                if (m_batch)
+                    throw usage_error("Can't convert the repo in the transaction");
+
+                if (m_config.repo.empty())
+                    throw usage_error("There is no repo");
+
+                hard_lock lock(m_guard);
+
+                pack_repo(m_config.repo, m_config.pier);
+
+                m_index = stamp(std::filesystem::path(m_config.repo) / index_file_name);
+                m_stamps.clear();
+            }
+
+            void unpack() noexcept(false) override
+            {
+                if (m_batch)
+                    throw usage_error("Can't convert the repo in the transaction");
+
+                if (m_config.repo.empty())
+                    throw usage_error("There is no repo");
+
+                hard_lock lock(m_guard);
+
+                unpack_repo(m_config.repo);
+
+                m_index = stamp();
+                for (const auto& pier : m_bundle)
+                    m_stamps[pier.first] = stamp(std::filesystem::path(m_config.repo) / pier.first / conf_file_name);
+            }
+
+            void begin() noexcept(false) override
+            {
+                if (m_batch)
+                    throw usage_error("The transaction is already started");
+
                 soft_lock lock(m_guard);
-                return get_x509_public_sha1(std::filesystem::path(m_config.repo) / pier / cert_file_name);
+                m_batch = std::make_unique<batch>(batch { m_bundle });
+            }
+
+            void apply(const batch& work) noexcept(false)
+            {
+                auto repo = std::filesystem::path(m_config.repo);
+
+                hard_lock lock(m_guard);
+
+                // all files are written aside first, the replaced files and the dropped folders are moved aside too
+                // and are restored if any step fails, so a crash in the middle is the only way to get a partial commit
+                std::vector<std::pair<std::filesystem::path, std::filesystem::path>> staged;
+                std::vector<std::pair<std::filesystem::path, std::filesystem::path>> aside;
+                std::vector<std::filesystem::path> placed;
+                std::vector<std::filesystem::path> created;
+
+                size_t count = 0;
+                auto temp = [&](const char* ext)
+                {
+                    return repo / ("webpier." + std::to_string(count++) + ext);
+                };
+
+                auto stage = [&](const std::filesystem::path& file)
+                {
+                    staged.emplace_back(temp(".tmp"), file);
+                    return staged.back().first;
+                };
+
+                try
+                {
+                    for (const auto& item : work.certs)
+                        save_x509_cert(stage(repo / item.first / cert_file_name), item.second);
+
+                    bool packed = exists_index(repo);
+                    if (packed)
+                    {
+                        catalog data;
+                        for (auto& pier : m_bundle)
+                        {
+                            auto& list = data[pier.first];
+                            for (auto& unit : pier.second)
+                                list.push_back(unit.second);
+                        }
+
+                        write_index(stage(repo / index_file_name), data);
+                    }
+                    else
+                    {
+                        for (const auto& pier : work.dirty)
+                        {
+                            auto iter = m_bundle.find(pier);
+                            if (iter == m_bundle.end())
+                                continue;
+
+                            std::vector<service> list;
+                            for (auto& unit : iter->second)
+                                list.push_back(unit.second);
+
+                            write_pier_services(stage(repo / pier / conf_file_name), list);
+                        }
+                    }
+
+                    for (const auto& pier : work.drops)
+                    {
+                        if (!std::filesystem::exists(repo / pier))
+                            continue;
+
+                        aside.emplace_back(repo / pier, temp(".del"));
+                        std::filesystem::rename(aside.back().first, aside.back().second);
+                    }
+
+                    for (const auto& item : staged)
+                    {
+                        std::vector<std::filesystem::path> missing;
+                        for (auto folder = item.second.parent_path(); !std::filesystem::exists(folder); folder = folder.parent_path())
+                            missing.push_back(folder);
+
+                        std::filesystem::create_directories(item.second.parent_path());
+                        created.insert(created.end(), missing.rbegin(), missing.rend());
+
+                        if (std::filesystem::exists(item.second))
+                        {
+                            aside.emplace_back(item.second, temp(".bak"));
+                            std::filesystem::rename(aside.back().first, aside.back().second);
+                        }
+
+                        std::filesystem::rename(item.first, item.second);
+                        placed.push_back(item.second);
+                    }
+                }
+                catch(const std::exception& e)
+                {
+                    std::error_code ec;
+                    for (auto iter = placed.rbegin(); iter != placed.rend(); ++iter)
+                        std::filesystem::remove(*iter, ec);
+
+                    for (auto iter = created.rbegin(); iter != created.rend(); ++iter)
+                        std::filesystem::remove(*iter, ec);
+
+                    for (auto iter = aside.rbegin(); iter != aside.rend(); ++iter)
+                        std::filesystem::rename(iter->second, iter->first, ec);
+
+                    for (const auto& item : staged)
+                        std::filesystem::remove(item.first, ec);
+
+                    throw file_error(e.what());
+                }
+
+                std::error_code ec;
+                for (const auto& item : aside)
+                    std::filesystem::remove_all(item.second, ec);
+
+                for (const auto& pier : work.drops)
+                    m_stamps.erase(pier);
+
+                if (exists_index(repo))
+                    m_index = stamp(repo / index_file_name);
+                else
+                {
+                    for (const auto& pier : work.dirty)
+                    {
+                        if (m_bundle.find(pier) != m_bundle.end())
+                            m_stamps[pier] = stamp(repo / pier / conf_file_name);
+                    }
+                }
+            }
+
+            void commit() noexcept(false) override
+            {
+                if (!m_batch)
+                    throw usage_error("There is no transaction");
+
+                if (!m_batch->dirty.empty() || !m_batch->drops.empty())
+                {
+                    try
+                    {
+                        apply(*m_batch);
+                    }
+                    catch (...)
+                    {
+                        rollback();
+                        throw;
+                    }
+                }
+
+                m_batch.reset();
+            }
+
+            void rollback() noexcept(true) override
+            {
+                if (!m_batch)
+                    return;
+
+                m_bundle = std::move(m_batch->origin);
+                m_batch.reset();
+                reindex();
+            }
+
+            bool is_useless_pier(const std::string& pier) const noexcept(true) override
+            {
+                return m_usage.find(pier) == m_usage.end();
+            }
+
+            std::string get_fingerprint(const std::string& pier) const noexcept(false) override
+            {
+                read_lock lock(m_guard);
+                return fetch_x509_info(pier).sha1;
             }
 
             std::string get_certificate(const std::string& pier) const noexcept(false) override
             {
-                soft_lock lock(m_guard);
-                return load_x509_cert(std::filesystem::path(m_config.repo) / pier / cert_file_name);
+                read_lock lock(m_guard);
+                return fetch_x509_info(pier).cert;
             }
         };
     }
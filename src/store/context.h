@@ -27,10 +27,11 @@ namespace webpier
     {
         std::string folder;
         wormhole::log::severity level = wormhole::log::debug;
+        bool merge = false;
 
-        bool operator==(const journal& other)
+        bool operator==(const journal& other) const
         {
-            return folder == other.folder && level == other.level;
+            return folder == other.folder && level == other.level && merge == other.merge;
         }
     };
 
@@ -41,7 +42,7 @@ namespace webpier
         plexus::checkup test = plexus::checkup::strict;
         uint8_t hops = 7;
 
-        bool operator==(const puncher& other)
+        bool operator==(const puncher& other) const
         {
             return udp_stun == other.udp_stun && tcp_stun == other.tcp_stun && test == other.test && hops == other.hops;
         }
@@ -53,7 +54,7 @@ namespace webpier
         uint16_t port = default_dht_port;
         uint32_t network = 0;
 
-        bool operator==(const dhtnode& other)
+        bool operator==(const dhtnode& other) const
         {
             return bootstrap == other.bootstrap && port == other.port && network == other.network;
         }
@@ -69,7 +70,7 @@ namespace webpier
         std::string key;
         std::string ca;
 
-        bool operator==(const emailer& other)
+        bool operator==(const emailer& other) const
         {
             return smtp == other.smtp && imap == other.imap && login == other.login
                 && password == other.password && cert == other.cert && key == other.key && ca == other.ca;
@@ -83,7 +84,7 @@ namespace webpier
         std::string key;
         std::string ca;
 
-        bool operator==(const ricochet& other)
+        bool operator==(const ricochet& other) const
         {
             return server == other.server && cert == other.cert && key == other.key && ca == other.ca;
         }
@@ -99,7 +100,7 @@ namespace webpier
         emailer email;
         ricochet relay;
 
-        bool operator==(const config& other)
+        bool operator==(const config& other) const
         {
             return pier == other.pier && repo == other.repo && log == other.log && nat == other.nat 
                         && dht == other.dht && email == other.email && relay == other.relay;
@@ -121,7 +122,7 @@ namespace webpier
         bool autostart = false;
         bool obscure = true;
 
-        bool operator==(const service& other)
+        bool operator==(const service& other) const
         {
             return local == other.local && name == other.name && pier == other.pier
                 && address == other.address && gateway == other.gateway && rendezvous == other.rendezvous
@@ -143,6 +144,7 @@ namespace webpier
         virtual void get_piers(std::vector<std::string>& list) const noexcept(true) = 0;
         virtual void add_pier(const std::string& pier, const std::string& cert) noexcept(false) = 0;
         virtual void del_pier(const std::string& pier) noexcept(false) = 0;
+        virtual bool is_useless_pier(const std::string& pier) const noexcept(true) = 0;
 
         virtual void get_export_services(std::vector<service>& list) const noexcept(true) = 0;
         virtual void get_import_services(std::vector<service>& list) const noexcept(true) = 0;
@@ -153,6 +155,20 @@ namespace webpier
         virtual void add_import_service(const service& info) noexcept(false) = 0;
         virtual void del_import_service(const std::string& pier, const std::string& name) noexcept(false) = 0;
 
+        // reloads the piers changed by other processes and returns their names, until then the reads
+        // keep the loaded state and the certificates are reread on demand, but the writes fail as stale
+        virtual std::vector<std::string> refresh() noexcept(false) = 0;
+
+        // converts the repo between the pier folders layout and the single file store
+        virtual void pack() noexcept(false) = 0;
+        virtual void unpack() noexcept(false) = 0;
+
+        // the changes made in the transaction are written on commit, each touched pier once, the failed commit
+        // restores the replaced files and rolls the transaction back
+        virtual void begin() noexcept(false) = 0;
+        virtual void commit() noexcept(false) = 0;
+        virtual void rollback() noexcept(true) = 0;
+
         virtual std::string get_certificate(const std::string& pier) const noexcept(false) = 0;
         virtual std::string get_fingerprint(const std::string& pier) const noexcept(false) = 0;
     };
@@ -0,0 +1,348 @@
+#include <store/index.h>
+#include <store/utils.h>
+#include <fstream>
+#include <sstream>
+#include <boost/property_tree/json_parser.hpp>
+
+namespace webpier
+{
+    namespace
+    {
+        constexpr const char* cert_file_name = "cert.crt";
+        constexpr const char* conf_file_name = "webpier.json";
+        constexpr const char* index_magic = "WPIX";
+        constexpr const uint32_t index_version = 1;
+
+        class writer
+        {
+            std::string m_data;
+
+        public:
+
+            void put(uint32_t value) noexcept(true)
+            {
+                for (size_t i = 0; i < 4; ++i)
+                    m_data.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+            }
+
+            void put(bool value) noexcept(true)
+            {
+                m_data.push_back(value ? 1 : 0);
+            }
+
+            void put(const std::string& value) noexcept(true)
+            {
+                std::string data = locale_to_utf8(value);
+                put(static_cast<uint32_t>(data.size()));
+                m_data.append(data);
+            }
+
+            void put(const service& unit) noexcept(true)
+            {
+                put(unit.local);
+                put(unit.name);
+                put(unit.pier);
+                put(unit.address);
+                put(unit.gateway);
+                put(unit.rendezvous);
+                put(static_cast<uint32_t>(unit.proto));
+                put(static_cast<uint32_t>(unit.role));
+                put(static_cast<uint32_t>(unit.route));
+                put(unit.autostart);
+                put(unit.obscure);
+            }
+
+            const std::string& data() const noexcept(true)
+            {
+                return m_data;
+            }
+        };
+
+        class reader
+        {
+            std::string m_data;
+            size_t m_pos = 0;
+
+            const char* take(size_t size) noexcept(false)
+            {
+                if (m_data.size() - m_pos < size)
+                    throw file_error("Malformed index");
+
+                const char* ptr = m_data.data() + m_pos;
+                m_pos += size;
+                return ptr;
+            }
+
+        public:
+
+            reader(std::string&& data) noexcept(true) : m_data(std::move(data))
+            {
+            }
+
+            void get(uint32_t& value) noexcept(false)
+            {
+                const char* ptr = take(4);
+
+                value = 0;
+                for (size_t i = 0; i < 4; ++i)
+                    value |= static_cast<uint32_t>(static_cast<uint8_t>(ptr[i])) << (i * 8);
+            }
+
+            void get(bool& value) noexcept(false)
+            {
+                value = *take(1) != 0;
+            }
+
+            void get(std::string& value) noexcept(false)
+            {
+                uint32_t size;
+                get(size);
+                const char* ptr = take(size);
+                value = utf8_to_locale(std::string(ptr, size));
+            }
+
+            void get(service& unit) noexcept(false)
+            {
+                uint32_t proto, role, route;
+                get(unit.local);
+                get(unit.name);
+                get(unit.pier);
+                get(unit.address);
+                get(unit.gateway);
+                get(unit.rendezvous);
+                get(proto);
+                get(role);
+                get(route);
+                get(unit.autostart);
+                get(unit.obscure);
+                unit.proto = wormhole::protocol(proto);
+                unit.role = wormhole::schema(role);
+                unit.route = plexus::routing::favour(route);
+            }
+
+            bool done() const noexcept(true)
+            {
+                return m_pos == m_data.size();
+            }
+        };
+    }
+
+    void load_pier_services(const std::filesystem::path& repo, const std::string& pier, bool host, std::vector<service>& list) noexcept(false)
+    {
+        try
+        {
+            auto file = repo / pier / conf_file_name;
+            if (std::filesystem::exists(file))
+            {
+                boost::property_tree::ptree doc;
+                boost::property_tree::read_json(file.string(), doc);
+
+                boost::property_tree::ptree array;
+                for (auto& item : doc.get_child("services", array))
+                {
+                    service unit;
+                    unit.local = item.second.get<bool>("local", host);
+                    unit.name = utf8_to_locale(item.second.get<std::string>("name", ""));
+                    unit.pier = utf8_to_locale(item.second.get<std::string>("pier", ""));
+                    unit.address = utf8_to_locale(item.second.get<std::string>("address", ""));
+                    unit.gateway = utf8_to_locale(item.second.get<std::string>("gateway", default_ip4_gateway));
+                    unit.rendezvous = utf8_to_locale(item.second.get<std::string>("rendezvous", ""));
+                    unit.proto = wormhole::protocol(item.second.get<int>("proto", wormhole::protocol::udp));
+                    unit.role = wormhole::schema(item.second.get<int>("role", unit.local ? wormhole::schema::server : wormhole::schema::client));
+                    unit.route = plexus::routing::favour(item.second.get<int>("route", plexus::routing::direct));
+                    unit.autostart = item.second.get<bool>("autostart", false);
+                    unit.obscure = item.second.get<bool>("obscure", true);
+                    list.push_back(unit);
+                }
+            }
+        }
+        catch(const std::exception& e)
+        {
+            throw file_error(e.what());
+        }
+    }
+
+    void write_pier_services(const std::filesystem::path& file, const std::vector<service>& list) noexcept(false)
+    {
+        try
+        {
+            boost::property_tree::ptree array;
+            for (auto& unit : list)
+            {
+                boost::property_tree::ptree item;
+                item.put("local", unit.local);
+                item.put("name", locale_to_utf8(unit.name));
+                item.put("pier", locale_to_utf8(unit.pier));
+                item.put("address", locale_to_utf8(unit.address));
+                item.put("gateway", locale_to_utf8(unit.gateway));
+                item.put("rendezvous", locale_to_utf8(unit.rendezvous));
+                item.put("proto", static_cast<int>(unit.proto));
+                item.put("role", static_cast<int>(unit.role));
+                item.put("route", static_cast<int>(unit.route));
+                item.put("autostart", unit.autostart);
+                item.put("obscure", unit.obscure);
+                array.push_back(std::make_pair("", item));
+            }
+
+            boost::property_tree::ptree doc;
+            doc.put_child("services", array);
+
+            boost::property_tree::write_json(file.string(), doc);
+        }
+        catch(const std::exception& e)
+        {
+            throw file_error(e.what());
+        }
+    }
+
+    void save_pier_services(const std::filesystem::path& repo, const std::string& pier, const std::vector<service>& list) noexcept(false)
+    {
+        auto file = repo / pier / conf_file_name;
+        auto temp = repo / pier / (std::string(conf_file_name) + ".tmp");
+
+        write_pier_services(temp, list);
+
+        try
+        {
+            std::filesystem::rename(temp, file);
+        }
+        catch(const std::exception& e)
+        {
+            throw file_error(e.what());
+        }
+    }
+
+    bool exists_index(const std::filesystem::path& repo) noexcept(true)
+    {
+        std::error_code ec;
+        return std::filesystem::exists(repo / index_file_name, ec);
+    }
+
+    void load_index(const std::filesystem::path& repo, catalog& data) noexcept(false)
+    {
+        std::ifstream file(repo / index_file_name, std::ios::binary);
+        if (!file)
+            throw file_error("Can't open the index");
+
+        std::stringstream ss;
+        ss << file.rdbuf();
+
+        reader in(ss.str());
+
+        std::string magic;
+        uint32_t version, piers;
+        in.get(magic);
+        in.get(version);
+
+        if (magic != index_magic || version != index_version)
+            throw file_error("Unknown index format");
+
+        in.get(piers);
+        for (uint32_t i = 0; i < piers; ++i)
+        {
+            std::string pier;
+            uint32_t count;
+            in.get(pier);
+            in.get(count);
+
+            auto& list = data[pier];
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                service unit;
+                in.get(unit);
+                list.push_back(unit);
+            }
+        }
+
+        if (!in.done())
+            throw file_error("Malformed index");
+    }
+
+    void write_index(const std::filesystem::path& file, const catalog& data) noexcept(false)
+    {
+        writer out;
+        out.put(std::string(index_magic));
+        out.put(index_version);
+        out.put(static_cast<uint32_t>(data.size()));
+        for (const auto& pier : data)
+        {
+            out.put(pier.first);
+            out.put(static_cast<uint32_t>(pier.second.size()));
+            for (const auto& unit : pier.second)
+                out.put(unit);
+        }
+
+        std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+        stream.write(out.data().data(), out.data().size());
+        stream.close();
+
+        if (!stream)
+            throw file_error("Can't write the index");
+    }
+
+    void save_index(const std::filesystem::path& repo, const catalog& data) noexcept(false)
+    {
+        auto path = repo / index_file_name;
+        auto temp = repo / (std::string(index_file_name) + ".tmp");
+
+        write_index(temp, data);
+
+        try
+        {
+            std::filesystem::rename(temp, path);
+        }
+        catch(const std::exception& e)
+        {
+            throw file_error(e.what());
+        }
+    }
+
+    void pack_repo(const std::filesystem::path& repo, const std::string& host) noexcept(false)
+    {
+        if (exists_index(repo))
+            throw usage_error("The repo is already packed");
+
+        catalog data;
+        for (auto const& owner : std::filesystem::directory_iterator(repo))
+        {
+            if (!owner.is_directory())
+                continue;
+
+            for (auto const& pin : std::filesystem::directory_iterator(owner.path()))
+            {
+                if (!pin.is_directory())
+                    continue;
+
+                if (!std::filesystem::exists(pin.path() / cert_file_name))
+                    continue;
+
+                auto pier = owner.path().filename().string() + "/" + pin.path().filename().string();
+                load_pier_services(repo, pier, pier == host, data[pier]);
+            }
+        }
+
+        save_index(repo, data);
+
+        for (const auto& pier : data)
+            std::filesystem::remove(repo / pier.first / conf_file_name);
+    }
+
+    void unpack_repo(const std::filesystem::path& repo) noexcept(false)
+    {
+        catalog data;
+        load_index(repo, data);
+
+        // the packed context knows its piers by the index only, so the piers without services are kept there,
+        // but they don't need the config files in the folders
+        for (const auto& pier : data)
+        {
+            if (pier.second.empty())
+                continue;
+
+            std::filesystem::create_directories(repo / pier.first);
+            save_pier_services(repo, pier.first, pier.second);
+        }
+
+        std::filesystem::remove(repo / index_file_name);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <store/context.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace webpier
+{
+    constexpr const char* index_file_name = "webpier.idx";
+
+    using catalog = std::map<std::string, std::vector<service>>;
+
+    // size and time of the file to notice its changes made by other processes
+    struct stamp
+    {
+        std::filesystem::file_time_type time;
+        std::uintmax_t size = 0;
+
+        stamp() = default;
+
+        stamp(const std::filesystem::path& file)
+        {
+            std::error_code ec;
+            time = std::filesystem::last_write_time(file, ec);
+            size = ec ? 0 : std::filesystem::file_size(file, ec);
+        }
+
+        bool operator==(const stamp& other) const
+        {
+            return time == other.time && size == other.size;
+        }
+    };
+
+    // services of the pier kept in its repo folder, the 'local' flag defaults to the 'host' value and the role to 'server' or 'client' by it for old files
+    void load_pier_services(const std::filesystem::path& repo, const std::string& pier, bool host, std::vector<service>& list) noexcept(false);
+    void save_pier_services(const std::filesystem::path& repo, const std::string& pier, const std::vector<service>& list) noexcept(false);
+    void write_pier_services(const std::filesystem::path& file, const std::vector<service>& list) noexcept(false);
+
+    // single file store of the services of all piers, the certificates and keys stay in the pier folders
+    bool exists_index(const std::filesystem::path& repo) noexcept(true);
+    void load_index(const std::filesystem::path& repo, catalog& data) noexcept(false);
+    void save_index(const std::filesystem::path& repo, const catalog& data) noexcept(false);
+    void write_index(const std::filesystem::path& file, const catalog& data) noexcept(false);
+
+    // lossless conversion of the repo between the pier folders layout and the single file store
+    void pack_repo(const std::filesystem::path& repo, const std::string& host) noexcept(false);
+    void unpack_repo(const std::filesystem::path& repo) noexcept(false);
+}
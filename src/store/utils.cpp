@@ -1,5 +1,6 @@
 #include <store/utils.h>
 #include <memory>
+#include <algorithm>
 #include <vector>
 #include <fstream>
 #include <sstream>
@@ -10,6 +11,8 @@
 #include <openssl/pem.h>
 #include <openssl/rand.h>
 #include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/conf.h>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -37,6 +40,10 @@
     #include <sysdir.h>
 #endif
 
+#ifdef BOOST_ASIO_HAS_IO_URING
+    #include <liburing.h>
+#endif
+
 namespace webpier
 {
     std::string get_openssl_error()
@@ -149,7 +156,7 @@ namespace webpier
             throw x509_error(get_openssl_error());
 
         unsigned char hash[SHA_DIGEST_LENGTH];
-        calc_digest(X509_get_pubkey(cert.get()), EVP_sha1(), hash, nullptr);
+        calc_digest(X509_get0_pubkey(cert.get()), EVP_sha1(), hash, nullptr);
 
         std::stringstream out;
         for (size_t i = 0; i < SHA_DIGEST_LENGTH; ++i)
@@ -171,7 +178,7 @@ namespace webpier
         if (!cert)
             throw x509_error(get_openssl_error());
 
-        if(!X509_verify(cert.get(), X509_get_pubkey(cert.get())))
+        if(!X509_verify(cert.get(), X509_get0_pubkey(cert.get())))
             throw x509_error(get_openssl_error());
 
         return buffer;
@@ -187,7 +194,7 @@ namespace webpier
         if (!cert)
             throw x509_error(get_openssl_error());
 
-        if(!X509_verify(cert.get(), X509_get_pubkey(cert.get())))
+        if(!X509_verify(cert.get(), X509_get0_pubkey(cert.get())))
             throw x509_error(get_openssl_error());
 
         std::unique_ptr<BIO, void (*)(BIO*)> file_bio(BIO_new(BIO_s_file()), BIO_free_all);
@@ -619,4 +626,130 @@ namespace webpier
 
         return resolve_same<boost::asio::ip::tcp>(v6 ? boost::asio::ip::tcp::v6() : boost::asio::ip::tcp::v4(), hostname, service);
     }
+
+    void enable_kernel_tls() noexcept(false)
+    {
+#ifdef SSL_OP_ENABLE_KTLS
+        if (!OPENSSL_init_ssl(OPENSSL_INIT_LOAD_CONFIG, nullptr))
+            throw std::runtime_error(get_openssl_error());
+
+        // the SSL contexts are created by the wormhole, so the option is passed by the 'system_default' settings,
+        // loading of the 'ssl_conf' module replaces the ssl settings of the system config, so they are carried over
+        std::vector<std::pair<std::string, std::vector<std::pair<std::string, std::string>>>> sections;
+
+        std::unique_ptr<CONF, void (*)(CONF*)> origin(NCONF_new(nullptr), NCONF_free);
+        std::unique_ptr<char, void (*)(char*)> file(CONF_get1_default_config_file(), [](char* ptr) { OPENSSL_free(ptr); });
+
+        long line = 0;
+        if (origin && file && NCONF_load(origin.get(), file.get(), &line) > 0)
+        {
+            const char* init = NCONF_get_string(origin.get(), nullptr, "openssl_conf");
+            const char* ssl = init ? NCONF_get_string(origin.get(), init, "ssl_conf") : nullptr;
+            auto list = ssl ? NCONF_get_section(origin.get(), ssl) : nullptr;
+
+            for (int i = 0; list && i < sk_CONF_VALUE_num(list); ++i)
+            {
+                auto item = sk_CONF_VALUE_value(list, i);
+                auto& section = sections.emplace_back(item->name, std::vector<std::pair<std::string, std::string>>()).second;
+
+                auto values = NCONF_get_section(origin.get(), item->value);
+                for (int j = 0; values && j < sk_CONF_VALUE_num(values); ++j)
+                {
+                    auto value = sk_CONF_VALUE_value(values, j);
+                    section.emplace_back(value->name, value->value);
+                }
+            }
+        }
+        ERR_clear_error();
+
+        auto iter = std::find_if(sections.begin(), sections.end(), [](const auto& item) { return item.first == "system_default"; });
+        if (iter == sections.end())
+            iter = sections.emplace(sections.end(), "system_default", std::vector<std::pair<std::string, std::string>>());
+
+        auto option = std::find_if(iter->second.begin(), iter->second.end(), [](const auto& item) { return item.first == "Options"; });
+        if (option == iter->second.end())
+            iter->second.emplace_back("Options", "KTLS");
+        else
+            option->second += ",KTLS";
+
+        // only the section names are written to the config text, the values are put to the loaded sections as is
+        std::ostringstream config;
+        config << "webpier_conf = webpier_sect\n[webpier_sect]\nssl_conf = webpier_ssl\n[webpier_ssl]\n";
+        for (size_t i = 0; i < sections.size(); ++i)
+            config << "webpier_name_" << i << " = webpier_ssl_" << i << "\n";
+
+        for (size_t i = 0; i < sections.size(); ++i)
+            config << "[webpier_ssl_" << i << "]\n";
+
+        auto text = config.str();
+        std::unique_ptr<BIO, void (*)(BIO*)> bio(BIO_new_mem_buf(text.data(), (int)text.size()), BIO_free_all);
+        if (!bio)
+            throw std::runtime_error(get_openssl_error());
+
+        std::unique_ptr<CONF, void (*)(CONF*)> conf(NCONF_new(nullptr), NCONF_free);
+        if (!conf)
+            throw std::runtime_error(get_openssl_error());
+
+        if (NCONF_load_bio(conf.get(), bio.get(), &line) <= 0)
+            throw std::runtime_error(get_openssl_error());
+
+        // the 'ssl_conf' module reads the sections by their lists, so the values don't need the lookup table
+        auto assign = [](CONF_VALUE* item, const std::string& name, const std::string& value)
+        {
+            char* head = OPENSSL_strdup(name.c_str());
+            char* data = OPENSSL_strdup(value.c_str());
+            if (!head || !data)
+            {
+                OPENSSL_free(head);
+                OPENSSL_free(data);
+                throw std::runtime_error(get_openssl_error());
+            }
+
+            OPENSSL_free(item->name);
+            OPENSSL_free(item->value);
+            item->name = head;
+            item->value = data;
+        };
+
+        auto names = NCONF_get_section(conf.get(), "webpier_ssl");
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            assign(sk_CONF_VALUE_value(names, (int)i), sections[i].first, "webpier_ssl_" + std::to_string(i));
+
+            auto values = NCONF_get_section(conf.get(), ("webpier_ssl_" + std::to_string(i)).c_str());
+            for (const auto& value : sections[i].second)
+            {
+                std::unique_ptr<CONF_VALUE, void (*)(CONF_VALUE*)> item(
+                    static_cast<CONF_VALUE*>(OPENSSL_zalloc(sizeof(CONF_VALUE))),
+                    [](CONF_VALUE* ptr) { OPENSSL_free(ptr->name); OPENSSL_free(ptr->value); OPENSSL_free(ptr); }
+                    );
+
+                if (!item)
+                    throw std::runtime_error(get_openssl_error());
+
+                assign(item.get(), value.first, value.second);
+
+                if (sk_CONF_VALUE_push(values, item.get()) <= 0)
+                    throw std::runtime_error(get_openssl_error());
+
+                item.release();
+            }
+        }
+
+        if (CONF_modules_load(conf.get(), "webpier_conf", 0) <= 0)
+            throw std::runtime_error(get_openssl_error());
+#endif
+    }
+
+#ifdef BOOST_ASIO_HAS_IO_URING
+    bool verify_io_uring() noexcept(true)
+    {
+        struct io_uring ring;
+        if (::io_uring_queue_init(1, &ring, 0) < 0)
+            return false;
+
+        ::io_uring_queue_exit(&ring);
+        return true;
+    }
+#endif
 }
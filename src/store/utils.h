@@ -29,6 +29,7 @@ namespace webpier
     void save_x509_cert(const std::filesystem::path& cert_path, const std::string& data) noexcept(false);
     std::string load_x509_cert(const std::filesystem::path& cert_path) noexcept(false);
     std::string get_x509_public_sha1(const std::filesystem::path& cert_path) noexcept(false);
+    void enable_kernel_tls() noexcept(false);
     std::string make_timestamp(const char* format) noexcept(true);
     std::string hexify(uint64_t value) noexcept(true);
     std::wstring utf8_to_unicode(const std::string& str) noexcept(true);
@@ -47,4 +48,7 @@ namespace webpier
     wormhole::endpoint resolve_tcp_endpoint(const std::string& hostname, const std::string& service) noexcept(false);
     wormhole::endpoint resolve_udp_endpoint(const std::string& hostname, const std::string& service, bool v6) noexcept(false);
     wormhole::endpoint resolve_tcp_endpoint(const std::string& hostname, const std::string& service, bool v6) noexcept(false);
+#ifdef BOOST_ASIO_HAS_IO_URING
+    bool verify_io_uring() noexcept(true);
+#endif
 }
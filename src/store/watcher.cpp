@@ -0,0 +1,255 @@
+#include <store/watcher.h>
+#include <boost/asio.hpp>
+#include <thread>
+#include <fstream>
+#include <map>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace webpier
+{
+    namespace
+    {
+        constexpr const char* lock_file_name = "webpier.lock";
+
+        class watcher_impl : public watcher
+        {
+            boost::asio::io_context m_io;
+            boost::asio::steady_timer m_timer;
+#ifdef __linux__
+            boost::asio::posix::stream_descriptor m_stream;
+            std::map<int, std::pair<std::filesystem::path, size_t>> m_watches;
+            int m_root_wd = -1;
+            alignas(inotify_event) char m_buffer[4096];
+#endif
+            std::function<void()> m_callback;
+            std::filesystem::path m_root;
+            size_t m_depth;
+            std::set<std::string> m_names;
+            size_t m_digest = 0;
+            std::thread m_thread;
+
+            static void combine(size_t& digest, const std::filesystem::path& path) noexcept(true)
+            {
+                std::error_code ec;
+                auto time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+                auto size = std::filesystem::is_regular_file(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+
+                for (size_t value : { std::hash<std::string>()(path.string()), std::hash<int64_t>()(time), std::hash<uintmax_t>()(size) })
+                    digest ^= value + 0x9e3779b9 + (digest << 6) + (digest >> 2);
+            }
+
+            static void combine(size_t& digest, const std::filesystem::path& folder, size_t depth) noexcept(true)
+            {
+                std::error_code ec;
+                for (auto iter = std::filesystem::directory_iterator(folder, ec); !ec && iter != std::filesystem::directory_iterator(); iter.increment(ec))
+                {
+                    combine(digest, iter->path());
+
+                    if (depth > 0 && iter->is_directory(ec))
+                        combine(digest, iter->path(), depth - 1);
+                }
+            }
+
+            size_t digest() const noexcept(true)
+            {
+                size_t res = 0;
+                if (!m_names.empty())
+                {
+                    for (const auto& name : m_names)
+                        combine(res, m_root / name);
+                    return res;
+                }
+
+                combine(res, m_root);
+                combine(res, m_root, m_depth);
+                return res;
+            }
+
+            void notify() noexcept(true)
+            {
+                try
+                {
+                    m_callback();
+                }
+                catch (const std::exception&) { }
+            }
+
+            void poll() noexcept(true)
+            {
+                m_timer.expires_after(std::chrono::seconds(1));
+                m_timer.async_wait([this](const boost::system::error_code& ec)
+                {
+                    if (ec)
+                        return;
+
+                    auto value = digest();
+                    if (value != m_digest)
+                    {
+                        m_digest = value;
+                        notify();
+                    }
+
+                    poll();
+                });
+            }
+
+#ifdef __linux__
+            void track(const std::filesystem::path& path, size_t level) noexcept(true)
+            {
+                int wd = inotify_add_watch(m_stream.native_handle(), path.string().c_str(), IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+                if (wd < 0)
+                    return;
+
+                m_watches[wd] = std::make_pair(path, level);
+
+                if (level < m_depth)
+                {
+                    std::error_code ec;
+                    for (auto iter = std::filesystem::directory_iterator(path, ec); !ec && iter != std::filesystem::directory_iterator(); iter.increment(ec))
+                    {
+                        if (iter->is_directory(ec))
+                            track(iter->path(), level + 1);
+                    }
+                }
+            }
+
+            void wait() noexcept(true)
+            {
+                m_stream.async_read_some(boost::asio::buffer(m_buffer), [this](const boost::system::error_code& ec, size_t size)
+                {
+                    if (ec)
+                        return;
+
+                    bool changed = false;
+                    bool lost = false;
+
+                    size_t offset = 0;
+                    while (offset + sizeof(inotify_event) <= size)
+                    {
+                        auto event = reinterpret_cast<const inotify_event*>(m_buffer + offset);
+                        offset += sizeof(inotify_event) + event->len;
+
+                        if (event->mask & IN_Q_OVERFLOW)
+                        {
+                            changed = true;
+                            continue;
+                        }
+
+                        if (event->mask & IN_IGNORED)
+                        {
+                            m_watches.erase(event->wd);
+                            lost = lost || event->wd == m_root_wd;
+                            continue;
+                        }
+
+                        if (event->wd == m_root_wd && !m_names.empty() && (event->len == 0 || m_names.count(event->name) == 0))
+                            continue;
+
+                        changed = true;
+
+                        // only the folder appeared inside the tracked tree is walked to be watched too
+                        if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)) && event->len > 0)
+                        {
+                            auto iter = m_watches.find(event->wd);
+                            if (iter != m_watches.end() && iter->second.second < m_depth)
+                                track(iter->second.first / event->name, iter->second.second + 1);
+                        }
+                    }
+
+                    if (changed || lost)
+                        notify();
+
+                    if (lost)
+                    {
+                        // the root is gone, so its reappearance can be noticed only by polling
+                        boost::system::error_code err;
+                        m_stream.close(err);
+                        m_watches.clear();
+                        m_digest = digest();
+                        poll();
+                        return;
+                    }
+
+                    wait();
+                });
+            }
+
+            bool listen() noexcept(true)
+            {
+                int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (fd < 0)
+                    return false;
+
+                m_stream.assign(fd);
+
+                track(m_root, 0);
+                if (m_watches.empty())
+                {
+                    boost::system::error_code ec;
+                    m_stream.close(ec);
+                    return false;
+                }
+
+                m_root_wd = m_watches.begin()->first;
+                wait();
+                return true;
+            }
+#else
+            bool listen() noexcept(true)
+            {
+                return false;
+            }
+#endif
+
+        public:
+
+            watcher_impl(const std::filesystem::path& root, size_t depth, const std::set<std::string>& names, const std::function<void()>& callback)
+                : m_timer(m_io)
+#ifdef __linux__
+                , m_stream(m_io)
+#endif
+                , m_callback(callback)
+                , m_root(root)
+                , m_depth(depth)
+                , m_names(names)
+            {
+                // the polling is left for the platforms and file systems that can't notify
+                if (!listen())
+                {
+                    m_digest = digest();
+                    poll();
+                }
+
+                m_thread = std::thread([this]() { m_io.run(); });
+            }
+
+            ~watcher_impl() override
+            {
+                m_io.stop();
+                m_thread.join();
+            }
+        };
+    }
+
+    watcher_ptr watch_context(const std::filesystem::path& home, const std::function<void()>& callback) noexcept(false)
+    {
+        auto file = home / lock_file_name;
+        if (!std::filesystem::exists(file))
+            std::ofstream(file).close();
+
+        return std::make_shared<watcher_impl>(home, 0, std::set<std::string>{ lock_file_name }, callback);
+    }
+
+    watcher_ptr watch_files(const std::filesystem::path& folder, const std::set<std::string>& names, const std::function<void()>& callback) noexcept(false)
+    {
+        return std::make_shared<watcher_impl>(folder, 0, names, callback);
+    }
+
+    watcher_ptr watch_folder(const std::filesystem::path& folder, size_t depth, const std::function<void()>& callback) noexcept(false)
+    {
+        return std::make_shared<watcher_impl>(folder, depth, std::set<std::string>(), callback);
+    }
+}
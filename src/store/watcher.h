@@ -0,0 +1,26 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <memory>
+#include <functional>
+#include <filesystem>
+
+namespace webpier
+{
+    struct watcher
+    {
+        virtual ~watcher() {}
+    };
+
+    using watcher_ptr = std::shared_ptr<watcher>;
+
+    // the callback is called from the watcher thread after any process commits changes of the context in the 'home' folder
+    watcher_ptr watch_context(const std::filesystem::path& home, const std::function<void()>& callback) noexcept(false);
+
+    // the callback is called from the watcher thread when any of the 'names' files in the 'folder' changes
+    watcher_ptr watch_files(const std::filesystem::path& folder, const std::set<std::string>& names, const std::function<void()>& callback) noexcept(false);
+
+    // the callback is called from the watcher thread when the 'folder' content changes down to the 'depth' of subfolders
+    watcher_ptr watch_folder(const std::filesystem::path& folder, size_t depth, const std::function<void()>& callback) noexcept(false);
+}
@@ -2,6 +2,7 @@
 #include <ui/messagedialog.h>
 #include <ui/startupdialog.h>
 #include <store/context.h>
+#include <store/watcher.h>
 #include <store/utils.h>
 #include <backend/client.h>
 #include <plexus/plexus.h>
@@ -36,6 +37,8 @@ namespace WebPier
     {
         std::shared_ptr<webpier::context> g_context;
         std::shared_ptr<slipway::client> g_backend;
+        std::optional<std::vector<slipway::handle>> g_batch;
+        webpier::watcher_ptr g_watcher;
 
         void InitContext(const std::string& home)
         {
@@ -325,7 +328,7 @@ namespace WebPier
                 webpier::config actual {
                     Pier.ToStdString(),
                     Repo.ToStdString(),
-                    { LogFolder.ToStdString(), static_cast<wormhole::log::severity>(LogLevel) },
+                    { LogFolder.ToStdString(), static_cast<wormhole::log::severity>(LogLevel), LogMerge },
                     { UdpStunServer.ToStdString(), TcpStunServer.ToStdString(), static_cast<plexus::checkup>(NatTest), NatHops },
                     { DhtBootstrap.ToStdString(), DhtPort },
                     { 
@@ -374,6 +377,7 @@ namespace WebPier
                 Repo = m_origin.repo;
                 LogFolder = m_origin.log.folder;
                 LogLevel = static_cast<Logging>(m_origin.log.level);
+                LogMerge = m_origin.log.merge;
                 UdpStunServer = m_origin.nat.udp_stun;
                 TcpStunServer = m_origin.nat.tcp_stun;
                 NatTest = static_cast<Checkup>(m_origin.nat.test);
@@ -396,9 +400,73 @@ namespace WebPier
 
         void Reload() noexcept(false)
         {
+            g_batch.reset();
             g_context = webpier::open_context(g_context->home());
         }
 
+        wxArrayString Refresh() noexcept(false)
+        {
+            wxArrayString list;
+            if (g_batch)
+                return list;
+
+            for (const auto& pier : g_context->refresh())
+                list.Add(pier);
+
+            return list;
+        }
+
+        void Watch(wxEvtHandler* owner, const std::function<void()>& handler) noexcept(false)
+        {
+            g_watcher.reset();
+
+            if (!owner)
+                return;
+
+            g_watcher = webpier::watch_context(g_context->home(), [owner, handler]()
+            {
+                owner->CallAfter(handler);
+            });
+        }
+
+        bool InTransaction() noexcept(true)
+        {
+            return g_batch.has_value();
+        }
+
+        void Begin() noexcept(false)
+        {
+            g_context->begin();
+            g_batch.emplace();
+        }
+
+        void Commit() noexcept(false)
+        {
+            auto batch = std::move(g_batch);
+            g_batch.reset();
+
+            g_context->commit();
+
+            if (batch && !batch->empty())
+            {
+                try
+                {
+                    std::vector<slipway::health> result;
+                    g_backend->adjust(*batch, result);
+                }
+                catch(const std::exception& ex)
+                {
+                    throw std::runtime_error(std::string("The changes are saved, but the services aren't adjusted. ") + ex.what());
+                }
+            }
+        }
+
+        void Rollback() noexcept(true)
+        {
+            g_batch.reset();
+            g_context->rollback();
+        }
+
         wxString Pier() noexcept(false)
         {
             return g_context->pier();
@@ -450,29 +518,7 @@ namespace WebPier
 
         bool IsUselessPier(const wxString& id) noexcept(false)
         {
-            auto isUsedForRemote = [&]()
-            {
-                std::vector<webpier::service> list;
-                g_context->get_import_services(list);
-                auto iter = std::find_if(list.begin(), list.end(), [pier = id.ToStdString()](const auto& item)
-                {
-                    return item.pier == pier;
-                });
-                return iter != list.end();
-            };
-
-            auto isUsedForLocal = [&]()
-            {
-                std::vector<webpier::service> list;
-                g_context->get_export_services(list);
-                auto iter = std::find_if(list.begin(), list.end(), [pier = id.ToStdString()](const auto& item)
-                {
-                    return item.pier.find(pier) != std::string::npos;
-                });
-                return iter != list.end();
-            };
-
-            return !isUsedForRemote() && !isUsedForLocal();
+            return g_context->is_useless_pier(id.ToStdString());
         }
 
         bool IsUnknownPier(const wxString& id) noexcept(false)
@@ -621,7 +667,10 @@ namespace WebPier
 
         void Adjust(const Handle& handle) noexcept(false)
         {
-            g_backend->adjust(Convert(handle));
+            if (g_batch)
+                g_batch->push_back(Convert(handle));
+            else
+                g_backend->adjust(Convert(handle));
         }
 
         void Engage() noexcept(false)
@@ -653,6 +702,26 @@ namespace WebPier
             return ret;
         }
 
+        bool Status(wxVector<Health>& health, wxUint64& stamp) noexcept(false)
+        {
+            slipway::query filter;
+            filter.fields = slipway::query::state | slipway::query::message;
+            filter.since = stamp;
+
+            slipway::digest result;
+            g_backend->status(filter, result);
+
+            stamp = result.stamp;
+            if (!result.changed)
+                return false;
+
+            health.clear();
+            for (const auto& item : result.items)
+                health.push_back(Convert(static_cast<const slipway::health&>(item)));
+
+            return true;
+        }
+
         Report Review(const Handle& handle) noexcept(false)
         {
             slipway::report result;
@@ -6,6 +6,7 @@
 #include <wx/hashmap.h>
 #include <wx/hashset.h>
 #include <wx/sharedptr.h>
+#include <wx/event.h>
 
 namespace WebPier
 {
@@ -95,6 +96,7 @@ namespace WebPier
             wxString Repo;
             wxString LogFolder;
             Logging LogLevel;
+            bool LogMerge;
             wxString UdpStunServer;
             wxString TcpStunServer;
             Checkup NatTest;
@@ -128,6 +130,12 @@ namespace WebPier
         };
 
         void Reload() noexcept(false);
+        wxArrayString Refresh() noexcept(false);
+        void Watch(wxEvtHandler* owner, const std::function<void()>& handler) noexcept(false);
+        bool InTransaction() noexcept(true);
+        void Begin() noexcept(false);
+        void Commit() noexcept(false);
+        void Rollback() noexcept(true);
         wxString Pier() noexcept(false);
         ConfigPtr GetConfig() noexcept(false);
         ServiceList GetExportServices() noexcept(false);
@@ -186,6 +194,7 @@ namespace WebPier
         void Adjust(const Handle& handle) noexcept(false);
         Health Status(const Handle& handle) noexcept(false);
         Report Review(const Handle& handle) noexcept(false);
+        bool Status(wxVector<Health>& health, wxUint64& stamp) noexcept(false);
         void AssignAutostart() noexcept(false);
         void RevokeAutostart() noexcept(false);
         bool VerifyAutostart() noexcept(false);
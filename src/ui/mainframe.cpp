@@ -8,6 +8,8 @@
 #include <ui/logo.h>
 #include <wx/stdpaths.h>
 #include <wx/notifmsg.h>
+#include <set>
+#include <map>
 
 const wxBitmap& GetStatusBitmap(WebPier::Backend::Health::Status state)
 {
@@ -26,47 +28,264 @@ const wxBitmap& GetStatusBitmap(WebPier::Backend::Health::Status state)
     return ::GetBlankBoxImage();
 }
 
-wxVector<wxVariant> CMainFrame::makeListItem(WebPier::Context::ServicePtr service) const
+wxString CServiceModel::makeKey(const wxString& pier, const wxString& service)
 {
-    WebPier::Backend::Health::Status state = service->Autostart ? WebPier::Backend::Health::Lonely : WebPier::Backend::Health::Asleep;
+    return pier + wxT('\t') + service;
+}
+
+wxString CServiceModel::makeKey(WebPier::Context::ServicePtr service) const
+{
+    return makeKey(service->Local ? m_host : service->Pier, service->Name);
+}
+
+int CServiceModel::findRow(WebPier::Context::ServicePtr service) const
+{
+    auto iter = m_index.find(makeKey(service));
+    return iter != m_index.end() && m_rows[iter->second].get() == service.get() ? static_cast<int>(iter->second) : wxNOT_FOUND;
+}
+
+void CServiceModel::refresh(const wxString& key)
+{
+    auto iter = m_index.find(key);
+    if (iter != m_index.end())
+        RowValueChanged(iter->second, 0);
+}
+
+unsigned int CServiceModel::GetColumnCount() const
+{
+    return 7;
+}
+
+wxString CServiceModel::GetColumnType(unsigned int col) const
+{
+    return col == 0 ? wxT("wxDataViewIconText") : wxT("string");
+}
+
+void CServiceModel::GetValueByRow(wxVariant& variant, unsigned int row, unsigned int col) const
+{
+    if (row >= m_rows.size())
+        return;
 
-    auto owner = service->Local ? WebPier::Context::Pier() : service->Pier;
-    for (const auto& item : m_status)
+    auto service = m_rows[row];
+    switch(col)
     {
-        if (item.Pier == owner && item.Service == service->Name)
-            state = item.State;
+        case 0:
+            variant << wxDataViewIconText(service->Name, GetStatusBitmap(GetHealth(row).State));
+            break;
+        case 1:
+            variant = service->Pier;
+            break;
+        case 2:
+            variant = service->Address;
+            break;
+        case 3:
+            variant = wxString(service->Rendezvous.IsEmpty() ? wxT("Email") : wxT("DHT"));
+            break;
+        case 4:
+            variant = ToString(service->Proto);
+            break;
+        case 5:
+            variant = ToString(service->Route);
+            break;
+        default:
+            variant = ToString(service->Autostart);
+            break;
     }
+}
 
-    wxVector<wxVariant> data;
-    data.push_back(wxVariant(wxDataViewIconText(service->Name, GetStatusBitmap(state))));
-    data.push_back(wxVariant(wxString(service->Pier)));
-    data.push_back(wxVariant(wxString(service->Address)));
-    data.push_back(wxVariant(wxString(service->Rendezvous.IsEmpty() ? wxT("Email") : wxT("DHT"))));
-    data.push_back(wxVariant(wxString(ToString(service->Proto))));
-    data.push_back(wxVariant(wxString(ToString(service->Route))));
-    data.push_back(wxVariant(wxString(ToString(service->Autostart))));
-    return data;
+bool CServiceModel::SetValueByRow(const wxVariant& variant, unsigned int row, unsigned int col)
+{
+    return false;
 }
 
-WebPier::Context::ServicePtr CMainFrame::findService(const WebPier::Backend::Handle& handle) const
+void CServiceModel::Assign(const wxString& host, const WebPier::Context::ServiceList& services, const WebPier::Context::ServiceList& others)
 {
-    if (handle.Pier == WebPier::Context::Pier())
+    m_host = host;
+    m_rows.clear();
+    m_keys.clear();
+    m_index.clear();
+    m_services.clear();
+
+    for (auto& item : services)
     {
-        for(auto& item : m_export)
-        {
-            if (item.second->Name == handle.Service)
-                return item.second;
-        }
+        m_index[makeKey(item.second)] = m_rows.size();
+        m_services[makeKey(item.second)] = item.second;
+        m_keys.push_back(makeKey(item.second));
+        m_rows.push_back(item.second);
     }
+
+    // the hidden services are only looked up by their handles
+    for (auto& item : others)
+        m_services[makeKey(item.second)] = item.second;
+
+    Reset(m_rows.size());
+}
+
+void CServiceModel::Append(WebPier::Context::ServicePtr service)
+{
+    m_index[makeKey(service)] = m_rows.size();
+    m_services[makeKey(service)] = service;
+    m_keys.push_back(makeKey(service));
+    m_rows.push_back(service);
+
+    RowAppended();
+}
+
+void CServiceModel::Change(unsigned int row)
+{
+    if (row >= m_rows.size())
+        return;
+
+    m_index.erase(m_keys[row]);
+    m_services.erase(m_keys[row]);
+    m_keys[row] = makeKey(m_rows[row]);
+    m_index[m_keys[row]] = row;
+    m_services[m_keys[row]] = m_rows[row];
+
+    RowChanged(row);
+}
+
+void CServiceModel::Remove(unsigned int row)
+{
+    if (row >= m_rows.size())
+        return;
+
+    m_index.erase(m_keys[row]);
+    m_services.erase(m_keys[row]);
+    m_keys.erase(m_keys.begin() + row);
+    m_rows.erase(m_rows.begin() + row);
+
+    for (unsigned int i = row; i < m_keys.size(); ++i)
+        m_index[m_keys[i]] = i;
+
+    RowDeleted(row);
+}
+
+void CServiceModel::Track(WebPier::Context::ServicePtr service)
+{
+    m_services[makeKey(service)] = service;
+}
+
+void CServiceModel::Replace(WebPier::Context::ServicePtr curr, WebPier::Context::ServicePtr next)
+{
+    int row = findRow(curr);
+    if (row == wxNOT_FOUND)
+    {
+        m_services.erase(makeKey(curr));
+        m_services[makeKey(next)] = next;
+        return;
+    }
+
+    m_rows[row] = next;
+    Change(row);
+}
+
+void CServiceModel::Drop(WebPier::Context::ServicePtr service)
+{
+    int row = findRow(service);
+    if (row == wxNOT_FOUND)
+        m_services.erase(makeKey(service));
     else
+        Remove(row);
+}
+
+WebPier::Context::ServicePtr CServiceModel::GetService(unsigned int row) const
+{
+    return row < m_rows.size() ? m_rows[row] : WebPier::Context::ServicePtr();
+}
+
+WebPier::Context::ServicePtr CServiceModel::FindService(const WebPier::Backend::Handle& handle) const
+{
+    auto iter = m_services.find(makeKey(handle.Pier, handle.Service));
+    return iter != m_services.end() ? iter->second : WebPier::Context::ServicePtr();
+}
+
+WebPier::Backend::Handle CServiceModel::GetHandle(unsigned int row) const
+{
+    auto service = m_rows[row];
+    return WebPier::Backend::Handle{ service->Local ? m_host : service->Pier, service->Name };
+}
+
+WebPier::Backend::Health CServiceModel::GetHealth(unsigned int row) const
+{
+    auto iter = m_health.find(m_keys[row]);
+    if (iter != m_health.end())
+        return iter->second;
+
+    // the services missed in the backend report are broken, until the first report they are shown by the autostart flag
+    auto state = m_known
+        ? WebPier::Backend::Health::Broken
+        : m_rows[row]->Autostart ? WebPier::Backend::Health::Lonely : WebPier::Backend::Health::Asleep;
+
+    return WebPier::Backend::Health{ GetHandle(row), state };
+}
+
+bool CServiceModel::LookupHealth(const WebPier::Backend::Handle& handle, WebPier::Backend::Health& health) const
+{
+    auto iter = m_health.find(makeKey(handle.Pier, handle.Service));
+    if (iter == m_health.end())
+        return false;
+
+    health = iter->second;
+    return true;
+}
+
+void CServiceModel::SetHealth(const WebPier::Backend::Health& health)
+{
+    auto key = makeKey(health.Pier, health.Service);
+    auto iter = m_health.find(key);
+    bool changed = iter == m_health.end() || iter->second.State != health.State;
+
+    m_health[key] = health;
+
+    if (changed)
+        refresh(key);
+}
+
+void CServiceModel::SetHealth(const wxVector<WebPier::Backend::Health>& health)
+{
+    CHealthIndex prev = m_health;
+    m_health.clear();
+
+    for (const auto& item : health)
+        m_health[makeKey(item.Pier, item.Service)] = item;
+
+    if (!m_known)
     {
-        for(auto& item : m_import)
-        {
-            if (handle.Pier == item.second->Pier && item.second->Name == handle.Service)
-                return item.second;
-        }
+        m_known = true;
+        for (unsigned int row = 0; row < m_rows.size(); ++row)
+            RowValueChanged(row, 0);
+        return;
     }
-    return WebPier::Context::ServicePtr();
+
+    for (const auto& item : m_health)
+    {
+        auto iter = prev.find(item.first);
+        if (iter == prev.end() || iter->second.State != item.second.State)
+            refresh(item.first);
+
+        if (iter != prev.end())
+            prev.erase(iter);
+    }
+
+    for (const auto& item : prev)
+        refresh(item.first);
+}
+
+void CServiceModel::ResetHealth()
+{
+    m_health.clear();
+    m_known = false;
+}
+
+bool CServiceModel::HasHealth() const
+{
+    return m_known;
+}
+
+WebPier::Context::ServicePtr CMainFrame::findService(const WebPier::Backend::Handle& handle) const
+{
+    return m_model->FindService(handle);
 }
 
 void CMainFrame::notify(const WebPier::Backend::Health& curr, const WebPier::Backend::Health& next)
@@ -103,7 +322,12 @@ void CMainFrame::notify(const WebPier::Backend::Health& curr, const WebPier::Bac
     }
 }
 
-CMainFrame::CMainFrame(wxTaskBarIcon* taskBar) : wxFrame(nullptr, wxID_ANY, wxT("WebPier"), wxDefaultPosition, wxSize(1000, 500), wxDEFAULT_FRAME_STYLE | wxTAB_TRAVERSAL), m_taskBar(taskBar)
+int CMainFrame::selectedRow() const
+{
+    return m_serviceList->HasSelection() ? static_cast<int>(m_model->GetRow(m_serviceList->GetSelection())) : wxNOT_FOUND;
+}
+
+CMainFrame::CMainFrame(wxTaskBarIcon* taskBar) : wxFrame(nullptr, wxID_ANY, wxT("WebPier"), wxDefaultPosition, wxSize(1000, 500), wxDEFAULT_FRAME_STYLE | wxTAB_TRAVERSAL), m_taskBar(taskBar), m_model(new CServiceModel())
 {
     this->SetIcon(::GetAppIconBundle().GetIcon());
     this->SetSizeHints( wxDefaultSize, wxDefaultSize );
@@ -170,14 +394,15 @@ CMainFrame::CMainFrame(wxTaskBarIcon* taskBar) : wxFrame(nullptr, wxID_ANY, wxT(
 
     panelSizer->Add( topSizer, 0, wxEXPAND, 5 );
 
-    m_serviceList = new wxDataViewListCtrl( m_mainPanel, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxDV_HORIZ_RULES|wxDV_ROW_LINES|wxDV_SINGLE|wxDV_VERT_RULES );
-    m_serviceList->AppendIconTextColumn( _("Service"), wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
-    m_serviceList->AppendTextColumn( _("Pier"), wxDATAVIEW_CELL_INERT, 350, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
-    m_serviceList->AppendTextColumn( _("Address"), wxDATAVIEW_CELL_INERT, 150, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
-    m_serviceList->AppendTextColumn( _("Rendezvous"), wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
-	m_serviceList->AppendTextColumn( _("Tunnel"), wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
-    m_serviceList->AppendTextColumn( _("Route"), wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
-    m_serviceList->AppendTextColumn( _("Autostart"), wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+    m_serviceList = new wxDataViewCtrl( m_mainPanel, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxDV_HORIZ_RULES|wxDV_ROW_LINES|wxDV_SINGLE|wxDV_VERT_RULES );
+    m_serviceList->AssociateModel( m_model.get() );
+    m_serviceList->AppendIconTextColumn( _("Service"), 0, wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+    m_serviceList->AppendTextColumn( _("Pier"), 1, wxDATAVIEW_CELL_INERT, 350, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+    m_serviceList->AppendTextColumn( _("Address"), 2, wxDATAVIEW_CELL_INERT, 150, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+    m_serviceList->AppendTextColumn( _("Rendezvous"), 3, wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+	m_serviceList->AppendTextColumn( _("Tunnel"), 4, wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+    m_serviceList->AppendTextColumn( _("Route"), 5, wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
+    m_serviceList->AppendTextColumn( _("Autostart"), 6, wxDATAVIEW_CELL_INERT, 100, static_cast<wxAlignment>(wxALIGN_LEFT), wxDATAVIEW_COL_RESIZABLE|wxDATAVIEW_COL_SORTABLE )->GetRenderer()->EnableEllipsize( wxELLIPSIZE_END );
     panelSizer->Add( m_serviceList, 1, wxALL|wxEXPAND, 5 );
 
 	m_mainPanel->SetSizer( panelSizer );
@@ -211,10 +436,19 @@ CMainFrame::CMainFrame(wxTaskBarIcon* taskBar) : wxFrame(nullptr, wxID_ANY, wxT(
     m_timer = new wxTimer(this);
     this->Bind( wxEVT_TIMER, wxTimerEventHandler(CMainFrame::onStatusTimeout), this, m_timer->GetId());
     m_timer->Start(500, true);
+
+    Register();
+    WebPier::Context::Watch(this, [this]()
+    {
+        onContextChange();
+    });
 }
 
 CMainFrame::~CMainFrame()
 {
+    WebPier::Context::Watch(nullptr, nullptr);
+    Unregister();
+
     delete m_importBtn;
     delete m_exportBtn;
     delete m_pierLabel;
@@ -243,34 +477,20 @@ void CMainFrame::RefreshStatus(const WebPier::Backend::Handle& handle)
         msg.Show(10);
     }
 
-    for (auto& status : m_status)
-    {
-        if (handle.Pier == status.Pier && handle.Service == status.Service)
-        {
-            notify(status, health);
-            status = health;
-            break;
-        }
-    }
-
-    int current = m_serviceList->GetSelectedRow();
-    for(int i = 0; i < m_serviceList->GetItemCount(); ++i)
-    {
-        wxVariant value;
-        m_serviceList->GetValue(value, i, 0);
+    WebPier::Backend::Health current;
+    if (m_model->LookupHealth(handle, current))
+        notify(current, health);
 
-        wxString service = value.GetAny().As<wxDataViewIconText>().GetText();
-        wxString pier = m_exportBtn->GetValue() ? WebPier::Context::Pier() : m_serviceList->GetTextValue(i, 1);
+    m_model->SetHealth(health);
 
-        if (handle.Service == service && handle.Pier == pier)
+    int row = selectedRow();
+    if (row != wxNOT_FOUND)
+    {
+        auto selected = m_model->GetHandle(row);
+        if (selected.Pier == handle.Pier && selected.Service == handle.Service)
         {
-            m_serviceList->SetValue(wxVariant(wxDataViewIconText(service, GetStatusBitmap(health.State))), i, 0);
-            if (current == i)
-            {
-                m_statusBar->SetStatusText(ToString(health.State), 0);
-                m_statusBar->SetStatusText(health.Message, 1);
-            }
-            break;
+            m_statusBar->SetStatusText(ToString(health.State), 0);
+            m_statusBar->SetStatusText(health.Message, 1);
         }
     }
 }
@@ -279,24 +499,19 @@ void CMainFrame::RefreshStatus()
 {
     try
     {
-        auto current = m_status;
-        m_status = WebPier::Backend::Status();
+        wxVector<WebPier::Backend::Health> status;
+        if (!WebPier::Backend::Status(status, m_stamp))
+            return;
 
-        for (const auto& status : m_status)
+        for (const auto& next : status)
         {
-            WebPier::Backend::Health health = { { status.Pier, status.Service }, WebPier::Backend::Health::Asleep };
-
-            for (const auto& item : current)
-            {
-                if (item.Pier == status.Pier && item.Service == status.Service)
-                {
-                    health = item;
-                    break;
-                }
-            }
-
-            notify(health, status);
+            WebPier::Backend::Health health = { { next.Pier, next.Service }, WebPier::Backend::Health::Asleep };
+            if (m_model->LookupHealth(next, health) || !m_silent)
+                notify(health, next);
         }
+
+        m_model->SetHealth(status);
+        m_silent = false;
     }
     catch(const std::exception& ex)
     {
@@ -305,43 +520,26 @@ void CMainFrame::RefreshStatus()
         msg.UseTaskBarIcon(m_taskBar);
 #endif
         msg.Show(10);
-        m_status.clear();
+        m_model->SetHealth(wxVector<WebPier::Backend::Health>());
+        m_stamp = 0;
     }
 
-    int current = m_serviceList->GetSelectedRow();
-    for(int i = 0; i < m_serviceList->GetItemCount(); ++i)
+    int row = selectedRow();
+    if (row != wxNOT_FOUND)
     {
-        wxVariant value;
-        m_serviceList->GetValue(value, i, 0);
-
-        wxString service = value.GetAny().As<wxDataViewIconText>().GetText();
-        wxString pier = m_exportBtn->GetValue() ? WebPier::Context::Pier() : m_serviceList->GetTextValue(i, 1);
-
-        WebPier::Backend::Health health = { {pier, service }, WebPier::Backend::Health::Broken };
-        for (const auto& item : m_status)
-        {
-            if (item.Pier == pier && item.Service == service)
-            {
-                health = item;
-                break;
-            }
-        }
-
-        m_serviceList->SetValue(wxVariant(wxDataViewIconText(service, GetStatusBitmap(health.State))), i, 0);
-        if (current == i)
-        {
-            m_statusBar->SetStatusText(ToString(health.State), 0);
-            m_statusBar->SetStatusText(health.Message, 1);
-        }
+        auto health = m_model->GetHealth(row);
+        m_statusBar->SetStatusText(ToString(health.State), 0);
+        m_statusBar->SetStatusText(health.Message, 1);
     }
 }
 
 void CMainFrame::onServiceItemCellActivated(wxDataViewEvent& event)
 {
-    int row = m_serviceList->ItemToRow(event.GetItem());
-    if (row == wxNOT_FOUND)
+    if (!event.GetItem().IsOk())
         return;
 
+    unsigned int row = m_model->GetRow(event.GetItem());
+
     if (event.GetColumn() != 0)
     {
         wxCommandEvent evt(wxEVT_COMMAND_BUTTON_CLICKED, m_editBtn->GetId());
@@ -350,23 +548,12 @@ void CMainFrame::onServiceItemCellActivated(wxDataViewEvent& event)
         return;
     }
 
-    wxVariant value;
-    m_serviceList->GetValue(value, row, 0);
+    auto info = m_model->GetHandle(row);
 
-    wxString service = value.GetAny().As<wxDataViewIconText>().GetText();
-    wxString pier = m_exportBtn->GetValue() ? WebPier::Context::Pier() : m_serviceList->GetTextValue(row, 1);
+    WebPier::Backend::Health health = { info, WebPier::Backend::Health::Asleep };
+    m_model->LookupHealth(info, health);
 
-    bool active = [&]()
-    {
-        for (const auto& item : m_status)
-        {
-            if (item.Pier == pier && item.Service == service)
-                return item.State != WebPier::Backend::Health::Asleep;
-        }
-        return false;
-    }();
-
-    auto info = WebPier::Backend::Handle{ pier, service };
+    bool active = health.State != WebPier::Backend::Health::Asleep;
 
     try
     {
@@ -387,46 +574,29 @@ void CMainFrame::onServiceItemCellActivated(wxDataViewEvent& event)
 
 void CMainFrame::onServiceItemSelectionChanged(wxDataViewEvent& event)
 {
-    int row = m_serviceList->ItemToRow(event.GetItem());
-    if (row == wxNOT_FOUND)
+    if (!event.GetItem().IsOk())
     {
         m_statusBar->SetStatusText(wxEmptyString, 0);
         m_statusBar->SetStatusText(wxEmptyString, 1);
         return;
     }
 
-    wxVariant value;
-    m_serviceList->GetValue(value, row, 0);
-
-    wxString service = value.GetAny().As<wxDataViewIconText>().GetText();
-    wxString pier = m_exportBtn->GetValue() ? WebPier::Context::Pier() : m_serviceList->GetTextValue(row, 1);
-
-    for (const auto& item : m_status)
+    WebPier::Backend::Health health;
+    if (m_model->LookupHealth(m_model->GetHandle(m_model->GetRow(event.GetItem())), health))
     {
-        if (item.Pier == pier && item.Service == service)
-        {
-            m_statusBar->SetStatusText(ToString(item.State), 0);
-            m_statusBar->SetStatusText(item.Message, 1);
-            break;
-        }
+        m_statusBar->SetStatusText(ToString(health.State), 0);
+        m_statusBar->SetStatusText(health.Message, 1);
     }
 }
 
 void CMainFrame::onServiceItemContextMenu(wxDataViewEvent& event)
 {
-    int row = m_serviceList->ItemToRow(event.GetItem());
-    if (row == wxNOT_FOUND)
+    if (!event.GetItem().IsOk())
         return;
-    
-    wxVariant value;
-    m_serviceList->GetValue(value, row, 0);
-
-    wxString service = value.GetAny().As<wxDataViewIconText>().GetText();
-    wxString pier = m_exportBtn->GetValue() ? WebPier::Context::Pier() : m_serviceList->GetTextValue(row, 1);
 
     try
     {
-        auto info = WebPier::Backend::Review(WebPier::Backend::Handle{pier, service});
+        auto info = WebPier::Backend::Review(m_model->GetHandle(m_model->GetRow(event.GetItem())));
 
         wxMenu* menu = new wxMenu();
         if (info.State == WebPier::Backend::Health::Asleep)
@@ -504,20 +674,136 @@ void CMainFrame::onStatusTimeout(wxTimerEvent& event)
     }
 }
 
-void CMainFrame::Populate()
+int CMainFrame::Enter(wxDialog* dialog)
 {
+    ++m_modals;
+    return wxID_NONE;
+}
+
+void CMainFrame::Exit(wxDialog* dialog)
+{
+    if (--m_modals == 0 && m_outdated)
+        CallAfter(&CMainFrame::onContextChange);
+}
+
+void CMainFrame::merge(WebPier::Context::ServiceList& list, const WebPier::Context::ServiceList& fresh, const std::set<wxString>& piers, bool shown)
+{
+    auto owner = [this](WebPier::Context::ServicePtr service)
+    {
+        return service->Local ? m_config->Pier : service->Pier;
+    };
+
+    std::map<std::pair<wxString, wxString>, WebPier::Context::ServicePtr> incoming;
+    for (auto& item : fresh)
+    {
+        if (piers.count(owner(item.second)))
+            incoming.emplace(std::make_pair(owner(item.second), item.second->Name), item.second);
+    }
+
+    // the services of the changed piers are matched by their handles, so only the really changed rows are touched
+    std::vector<std::pair<WebPier::Context::ServicePtr, WebPier::Context::ServicePtr>> changes;
+    for (auto& item : list)
+    {
+        if (piers.count(owner(item.second)) == 0)
+            continue;
+
+        auto iter = incoming.find(std::make_pair(owner(item.second), item.second->Name));
+        if (iter == incoming.end())
+        {
+            changes.emplace_back(item.second, WebPier::Context::ServicePtr());
+            continue;
+        }
+
+        if (!WebPier::Context::IsEqual(item.second, iter->second))
+            changes.emplace_back(item.second, iter->second);
+
+        incoming.erase(iter);
+    }
+
+    for (auto& change : changes)
+    {
+        list.erase(wxUIntPtr(change.first.get()));
+
+        if (change.second)
+        {
+            list[wxUIntPtr(change.second.get())] = change.second;
+            m_model->Replace(change.first, change.second);
+        }
+        else
+        {
+            m_model->Drop(change.first);
+        }
+    }
+
+    for (auto& item : incoming)
+    {
+        list[wxUIntPtr(item.second.get())] = item.second;
+        if (shown)
+            m_model->Append(item.second);
+        else
+            m_model->Track(item.second);
+    }
+}
+
+void CMainFrame::onContextChange()
+{
+    // the services may be edited by a dialog or a transaction, so the refresh waits for their end
+    if (m_modals > 0 || WebPier::Context::InTransaction())
+    {
+        m_outdated = true;
+        return;
+    }
+
+    m_outdated = false;
+
     try
     {
-        m_serviceList->DeleteAllItems();
+        auto changed = WebPier::Context::Refresh();
 
+        auto config = WebPier::Context::GetConfig();
+        if (!m_config || config->Pier != m_config->Pier)
+        {
+            Populate();
+            return;
+        }
+
+        m_config = config;
+
+        if (changed.IsEmpty())
+            return;
+
+        std::set<wxString> piers(changed.begin(), changed.end());
+        if (piers.count(m_config->Pier))
+            merge(m_export, WebPier::Context::GetExportServices(), piers, m_exportBtn->GetValue());
+
+        if (piers.size() > piers.count(m_config->Pier))
+            merge(m_import, WebPier::Context::GetImportServices(), piers, m_importBtn->GetValue());
+    }
+    catch(const std::exception& ex)
+    {
+        CMessageDialog dialog(nullptr, _("Can't refresh the context. ") + ex.what(), wxDEFAULT_DIALOG_STYLE|wxICON_ERROR);
+        dialog.ShowModal();
+
+        WebPier::Context::Reload();
+        Populate();
+    }
+}
+
+void CMainFrame::Populate()
+{
+    // the services being run already must not be announced again after the full status reload
+    m_silent = m_silent || m_model->HasHealth();
+    m_stamp = 0;
+    m_model->ResetHealth();
+
+    try
+    {
         m_config = WebPier::Context::GetConfig();
         m_export = WebPier::Context::GetExportServices();
         m_import = WebPier::Context::GetImportServices();
 
         m_pierLabel->SetLabel(m_config->Pier);
-
-        for (auto& item : m_importBtn->GetValue() ? m_import : m_export)
-            m_serviceList->AppendItem(makeListItem(item.second), item.first);
+        m_model->Assign(m_config->Pier, m_importBtn->GetValue() ? m_import : m_export, m_importBtn->GetValue() ? m_export : m_import);
 
         m_importItem->Enable(true);
         m_exportItem->Enable(true);
@@ -530,6 +816,8 @@ void CMainFrame::Populate()
         CMessageDialog dialog(nullptr, _("Can't populate the service list. ") + ex.what(), wxDEFAULT_DIALOG_STYLE|wxICON_ERROR);
         dialog.ShowModal();
 
+        m_model->Assign(wxEmptyString, WebPier::Context::ServiceList(), WebPier::Context::ServiceList());
+
         m_importItem->Enable(false);
         m_exportItem->Enable(false);
         m_addBtn->Enable(false);
@@ -585,7 +873,7 @@ void CMainFrame::onAddServiceButtonClick(wxCommandEvent& event)
             else
                 m_import[wxUIntPtr(service.get())] = service;
 
-            m_serviceList->AppendItem(makeListItem(service), wxUIntPtr(service.get()));
+            m_model->Append(service);
         }
         catch(const std::exception& ex)
         {
@@ -603,9 +891,8 @@ void CMainFrame::onEditServiceButtonClick(wxCommandEvent& event)
     if (!m_serviceList->HasSelection())
         return event.Skip();
 
-    auto& services = m_exportBtn->GetValue() ? m_export : m_import;
-    auto iter = services.find(m_serviceList->GetItemData(m_serviceList->GetSelection()));
-    WebPier::Context::ServicePtr service = iter != services.end() ? iter->second : WebPier::Context::ServicePtr();
+    int row = selectedRow();
+    WebPier::Context::ServicePtr service = m_model->GetService(row);
 
     try
     {
@@ -616,11 +903,7 @@ void CMainFrame::onEditServiceButtonClick(wxCommandEvent& event)
         if (dialog.ShowModal() == wxID_OK && service->IsDirty())
         {
             service->Store();
-            auto row = m_serviceList->GetSelectedRow();
-            m_serviceList->DeleteItem(row);
-
-            m_serviceList->InsertItem(row, makeListItem(service), wxUIntPtr(service.get()));
-            m_serviceList->SelectRow(row);
+            m_model->Change(row);
         }
     }
     catch (const std::exception& ex)
@@ -679,6 +962,8 @@ void CMainFrame::OnImportMenuSelection(wxCommandEvent& event)
         if (dialog.ShowModal() != wxID_OK)
             return;
 
+        WebPier::Context::Begin();
+
         if (replacePier)
             WebPier::Context::DelPier(offer.Pier);
 
@@ -688,9 +973,13 @@ void CMainFrame::OnImportMenuSelection(wxCommandEvent& event)
         auto exports = dialog.GetExport();
         auto imports = dialog.GetImport();
 
+        std::set<std::pair<wxString, wxString>> chosen;
+        for (auto& item : exports)
+            chosen.emplace(item.second->Pier, item.second->Name);
+
         for (auto& item : m_export)
         {
-            if (exports.find(item.first) == exports.end())
+            if (chosen.count(std::make_pair(item.second->Pier, item.second->Name)) == 0)
                 item.second->DelPier(offer.Pier);
             else
                 item.second->AddPier(offer.Pier);
@@ -737,6 +1026,8 @@ void CMainFrame::OnImportMenuSelection(wxCommandEvent& event)
                 item.second->Store();
         }
 
+        WebPier::Context::Commit();
+
         Populate();
 
         if (dialog.NeedExportReply())
@@ -750,6 +1041,8 @@ void CMainFrame::OnImportMenuSelection(wxCommandEvent& event)
     }
     catch (const std::exception& ex)
     {
+        WebPier::Context::Rollback();
+
         CMessageDialog dialog(nullptr, _("Offer uploading failed. ") + ex.what(), wxDEFAULT_DIALOG_STYLE | wxICON_ERROR);
         dialog.ShowModal();
 
@@ -789,7 +1082,8 @@ void CMainFrame::onDeleteServiceButtonClick(wxCommandEvent& event)
     try
     {
         auto& services = m_exportBtn->GetValue() ? m_export : m_import;
-        auto iter = services.find(m_serviceList->GetItemData(m_serviceList->GetSelection()));
+        int row = selectedRow();
+        auto iter = services.find(wxUIntPtr(m_model->GetService(row).get()));
         if (iter == services.end())
             throw std::runtime_error(_("The service item is not found"));
 
@@ -799,7 +1093,7 @@ void CMainFrame::onDeleteServiceButtonClick(wxCommandEvent& event)
         {
             service->Purge();
 
-            m_serviceList->DeleteItem(m_serviceList->GetSelectedRow());
+            m_model->Remove(row);
             services.erase(iter);
         }
     }
@@ -25,8 +25,55 @@
 #include <wx/aboutdlg.h> 
 #include <wx/timer.h>
 #include <wx/taskbar.h>
+#include <wx/modalhook.h>
+#include <set>
 
-class CMainFrame : public wxFrame
+WX_DECLARE_STRING_HASH_MAP(unsigned int, CRowIndex);
+WX_DECLARE_STRING_HASH_MAP(WebPier::Backend::Health, CHealthIndex);
+WX_DECLARE_STRING_HASH_MAP(WebPier::Context::ServicePtr, CServiceIndex);
+
+class CServiceModel : public wxDataViewIndexListModel
+{
+    wxString m_host;
+    wxVector<WebPier::Context::ServicePtr> m_rows;
+    wxVector<wxString> m_keys;
+    CRowIndex m_index;
+    CServiceIndex m_services;
+    CHealthIndex m_health;
+    bool m_known = false;
+
+    static wxString makeKey(const wxString& pier, const wxString& service);
+    wxString makeKey(WebPier::Context::ServicePtr service) const;
+    int findRow(WebPier::Context::ServicePtr service) const;
+    void refresh(const wxString& key);
+
+public:
+
+    unsigned int GetColumnCount() const override;
+    wxString GetColumnType(unsigned int col) const override;
+    void GetValueByRow(wxVariant& variant, unsigned int row, unsigned int col) const override;
+    bool SetValueByRow(const wxVariant& variant, unsigned int row, unsigned int col) override;
+
+    void Assign(const wxString& host, const WebPier::Context::ServiceList& services, const WebPier::Context::ServiceList& others);
+    void Append(WebPier::Context::ServicePtr service);
+    void Change(unsigned int row);
+    void Remove(unsigned int row);
+    void Track(WebPier::Context::ServicePtr service);
+    void Replace(WebPier::Context::ServicePtr curr, WebPier::Context::ServicePtr next);
+    void Drop(WebPier::Context::ServicePtr service);
+
+    WebPier::Context::ServicePtr GetService(unsigned int row) const;
+    WebPier::Context::ServicePtr FindService(const WebPier::Backend::Handle& handle) const;
+    WebPier::Backend::Handle GetHandle(unsigned int row) const;
+    WebPier::Backend::Health GetHealth(unsigned int row) const;
+    bool LookupHealth(const WebPier::Backend::Handle& handle, WebPier::Backend::Health& health) const;
+    void SetHealth(const WebPier::Backend::Health& health);
+    void SetHealth(const wxVector<WebPier::Backend::Health>& health);
+    void ResetHealth();
+    bool HasHealth() const;
+};
+
+class CMainFrame : public wxFrame, public wxModalDialogHook
 {
     wxTaskBarIcon* m_taskBar;
     wxMenuItem* m_importItem;
@@ -37,20 +84,28 @@ class CMainFrame : public wxFrame
     wxBitmapButton* m_addBtn;
     wxBitmapButton* m_editBtn;
     wxBitmapButton* m_deleteBtn;
-    wxDataViewListCtrl* m_serviceList;
+    wxDataViewCtrl* m_serviceList;
+    wxObjectDataPtr<CServiceModel> m_model;
     wxStatusBar* m_statusBar;
     wxPanel* m_mainPanel;
     wxTimer* m_timer;
     WebPier::Context::ConfigPtr m_config;
     WebPier::Context::ServiceList m_export;
     WebPier::Context::ServiceList m_import;
-    wxVector<WebPier::Backend::Health> m_status;
+    wxUint64 m_stamp = 0;
+    bool m_silent = false;
+    int m_modals = 0;
+    bool m_outdated = false;
 
 protected:
 
-    wxVector<wxVariant> makeListItem(WebPier::Context::ServicePtr service) const;
+    int Enter(wxDialog* dialog) override;
+    void Exit(wxDialog* dialog) override;
+
+    int selectedRow() const;
     WebPier::Context::ServicePtr findService(const WebPier::Backend::Handle& handle) const;
     void notify(const WebPier::Backend::Health& curr, const WebPier::Backend::Health& next);
+    void merge(WebPier::Context::ServiceList& list, const WebPier::Context::ServiceList& fresh, const std::set<wxString>& piers, bool shown);
 
 
 
@@ -65,6 +120,7 @@ protected:
     void onServiceItemSelectionChanged(wxDataViewEvent& event);
     void onServiceItemCellActivated(wxDataViewEvent& event);
     void onStatusTimeout(wxTimerEvent& event);
+    void onContextChange();
 
 public:
 
@@ -87,6 +87,12 @@ CSettingsDialog::CSettingsDialog(WebPier::Context::ConfigPtr config, const wxStr
 
     basicSizer->Add(m_daemonCtrl, 0, wxALL, 5);
 
+    m_mergeCtrl = new wxCheckBox(basicPanel, wxID_ANY, _("Write the tunnel logs to a single daily file"), wxDefaultPosition, wxDefaultSize, 0);
+    m_mergeCtrl->SetToolTip(_("The tunnel logs are collected to the 'carrier.<date>.log' file of the journal folder, otherwise each tunnel writes its own log file there"));
+    m_mergeCtrl->SetValue(m_config->LogMerge);
+
+    basicSizer->Add(m_mergeCtrl, 0, wxALL, 5);
+
     basicPanel->SetSizer(basicSizer);
     basicPanel->Layout();
     basicSizer->Fit(basicPanel);
@@ -751,6 +757,7 @@ void CSettingsDialog::onOkButtonClick(wxCommandEvent &event)
     }
 
     m_config->Pier = pier;
+    m_config->LogMerge = m_mergeCtrl->GetValue();
 
     m_config->UdpStunServer = m_udpStunCtrl->GetValue();
     m_config->TcpStunServer = m_tcpStunCtrl->GetValue();
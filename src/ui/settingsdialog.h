@@ -33,6 +33,7 @@ class CSettingsDialog : public wxDialog, public std::enable_shared_from_this<CSe
     wxTextCtrl* m_ownerCtrl;
     wxTextCtrl* m_pierCtrl;
     wxCheckBox* m_daemonCtrl;
+    wxCheckBox* m_mergeCtrl;
     wxPanel* m_natPanel;
     wxCheckBox* m_isNat;
     wxChoice* m_testMode;
@@ -1,9 +1,15 @@
 #include <store/context.h>
+#include <store/index.h>
+#include <store/watcher.h>
 #include <store/utils.h>
 #include <boost/test/unit_test.hpp>
 #include <boost/scope_exit.hpp>
 #include <boost/filesystem.hpp>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <atomic>
+#include <algorithm>
 
 BOOST_AUTO_TEST_CASE(context)
 {
@@ -27,7 +33,7 @@ BOOST_AUTO_TEST_CASE(context)
     webpier::config in {
         peer,
         prep.string(),
-        { dest.string() },
+        { dest.string(), wormhole::log::trace, true },
         {},
         {},
         {
@@ -57,6 +63,9 @@ BOOST_AUTO_TEST_CASE(context)
     context->get_config(out);
 
     BOOST_CHECK_EQUAL(out.pier, in.pier);
+    BOOST_CHECK_EQUAL(out.log.folder, in.log.folder);
+    BOOST_CHECK_EQUAL(out.log.level, in.log.level);
+    BOOST_CHECK_EQUAL(out.log.merge, in.log.merge);
     BOOST_CHECK_EQUAL(out.nat.udp_stun, in.nat.udp_stun);
     BOOST_CHECK_EQUAL(out.nat.tcp_stun, in.nat.tcp_stun);
     BOOST_CHECK_EQUAL(out.nat.hops, in.nat.hops);
@@ -159,8 +168,215 @@ BOOST_AUTO_TEST_CASE(context)
     BOOST_CHECK_EQUAL(service.obscure, remotes[0].obscure);
 
     BOOST_REQUIRE_NO_THROW(context->del_pier(peer));
+    BOOST_REQUIRE_THROW(context->get_fingerprint(peer), webpier::x509_error);
 
     remotes.clear();
     context->get_import_services(remotes);
     BOOST_REQUIRE(remotes.empty());
+
+    webpier::generate_x509_pair(dest / "cert.crt", dest / "private.key", peer);
+    peer_certificate = webpier::load_x509_cert(dest / "cert.crt");
+
+    BOOST_REQUIRE_NO_THROW(context->add_pier(peer, peer_certificate));
+    BOOST_REQUIRE_NO_THROW(BOOST_CHECK_EQUAL(context->get_certificate(peer), peer_certificate));
+    BOOST_REQUIRE_NO_THROW(BOOST_CHECK_NE(context->get_fingerprint(peer), peer_fingerprint));
+
+    BOOST_REQUIRE_NO_THROW(context->add_import_service(service));
+    BOOST_CHECK(!context->is_useless_pier(peer));
+    BOOST_CHECK(context->is_useless_pier("unknown@mail.box/test"));
+
+    BOOST_REQUIRE_NO_THROW(context->add_pier("idle@mail.box/test", peer_certificate));
+    BOOST_CHECK(!std::filesystem::exists(hrep / "idle@mail.box/test" / "webpier.json"));
+
+    BOOST_REQUIRE_NO_THROW(context->pack());
+    BOOST_REQUIRE_THROW(context->pack(), webpier::usage_error);
+    BOOST_CHECK(webpier::exists_index(hrep));
+    BOOST_CHECK(!std::filesystem::exists(hrep / peer / "webpier.json"));
+
+    auto packed = webpier::open_context(dest.string());
+
+    locals.clear();
+    remotes.clear();
+    packed->get_export_services(locals);
+    packed->get_import_services(remotes);
+
+    BOOST_REQUIRE_EQUAL(locals.size(), 1);
+    BOOST_REQUIRE_EQUAL(remotes.size(), 1);
+    BOOST_CHECK(locals[0].local);
+    BOOST_CHECK_EQUAL(locals[0].name, "bar");
+    BOOST_CHECK(remotes[0] == service);
+    BOOST_CHECK(!packed->is_useless_pier(peer));
+
+    service.name = "baz";
+
+    BOOST_REQUIRE_NO_THROW(packed->add_import_service(service));
+    BOOST_REQUIRE_NO_THROW(packed->del_import_service(service.pier, "bar"));
+
+    list.clear();
+    packed->get_piers(list);
+    BOOST_CHECK_EQUAL(list.size(), 2);
+
+    BOOST_REQUIRE_NO_THROW(packed->unpack());
+    BOOST_CHECK(!webpier::exists_index(hrep));
+    BOOST_CHECK(!std::filesystem::exists(hrep / "idle@mail.box/test" / "webpier.json"));
+
+    auto unpacked = webpier::open_context(dest.string());
+
+    remotes.clear();
+    unpacked->get_import_services(remotes);
+
+    BOOST_REQUIRE_EQUAL(remotes.size(), 1);
+    BOOST_CHECK(remotes[0] == service);
+
+    auto stamp = std::filesystem::last_write_time(dest / "webpier.lock");
+
+    BOOST_REQUIRE_NO_THROW(unpacked->begin());
+    BOOST_REQUIRE_THROW(unpacked->begin(), webpier::usage_error);
+
+    service.name = "qux";
+
+    BOOST_REQUIRE_NO_THROW(unpacked->add_import_service(service));
+    BOOST_REQUIRE_NO_THROW(unpacked->del_import_service(service.pier, "baz"));
+
+    unpacked->rollback();
+
+    remotes.clear();
+    unpacked->get_import_services(remotes);
+
+    BOOST_REQUIRE_EQUAL(remotes.size(), 1);
+    BOOST_CHECK_EQUAL(remotes[0].name, "baz");
+
+    BOOST_REQUIRE_NO_THROW(unpacked->begin());
+    BOOST_REQUIRE_NO_THROW(unpacked->del_pier(peer));
+    BOOST_REQUIRE_NO_THROW(unpacked->add_pier(peer, peer_certificate));
+    BOOST_REQUIRE_NO_THROW(unpacked->add_import_service(service));
+    BOOST_CHECK(stamp == std::filesystem::last_write_time(dest / "webpier.lock"));
+    BOOST_REQUIRE_NO_THROW(unpacked->commit());
+    BOOST_REQUIRE_THROW(unpacked->commit(), webpier::usage_error);
+    BOOST_CHECK(stamp != std::filesystem::last_write_time(dest / "webpier.lock"));
+
+    auto reader = webpier::open_context(dest.string());
+
+    remotes.clear();
+    reader->get_import_services(remotes);
+
+    BOOST_REQUIRE_EQUAL(remotes.size(), 1);
+    BOOST_CHECK(remotes[0] == service);
+    BOOST_CHECK_EQUAL(reader->get_certificate(peer), peer_certificate);
+
+    std::promise<void> promise;
+    std::atomic<bool> fired(false);
+    auto watcher = webpier::watch_context(dest, [&]()
+    {
+        if (!fired.exchange(true))
+            promise.set_value();
+    });
+
+    BOOST_CHECK(reader->refresh().empty());
+
+    service.name = "quux";
+
+    BOOST_REQUIRE_NO_THROW(unpacked->add_import_service(service));
+    BOOST_REQUIRE(promise.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+
+    auto changed = reader->refresh();
+
+    BOOST_REQUIRE_EQUAL(changed.size(), 1);
+    BOOST_CHECK_EQUAL(changed[0], peer);
+    BOOST_CHECK(reader->refresh().empty());
+
+    remotes.clear();
+    reader->get_import_services(remotes);
+
+    BOOST_CHECK_EQUAL(remotes.size(), 2);
+
+    BOOST_REQUIRE_NO_THROW(reader->begin());
+    BOOST_REQUIRE_THROW(reader->refresh(), webpier::usage_error);
+    reader->rollback();
+
+    service.name = "corge";
+
+    BOOST_REQUIRE_NO_THROW(unpacked->add_import_service(service));
+    BOOST_CHECK_EQUAL(reader->get_certificate(peer), peer_certificate);
+    BOOST_CHECK_NO_THROW(reader->get_fingerprint(peer));
+
+    remotes.clear();
+    reader->get_import_services(remotes);
+
+    BOOST_CHECK_EQUAL(remotes.size(), 2);
+    BOOST_REQUIRE_THROW(reader->begin(), webpier::stale_error);
+    BOOST_CHECK_EQUAL(reader->refresh().size(), 1);
+    BOOST_REQUIRE_NO_THROW(reader->begin());
+
+    service.name = "grault";
+
+    BOOST_REQUIRE_NO_THROW(reader->add_import_service(service));
+    BOOST_REQUIRE_NO_THROW(unpacked->del_import_service(peer, "corge"));
+    BOOST_REQUIRE_THROW(reader->commit(), webpier::stale_error);
+    BOOST_REQUIRE_THROW(reader->commit(), webpier::usage_error);
+
+    remotes.clear();
+    reader->get_import_services(remotes);
+
+    BOOST_CHECK_EQUAL(remotes.size(), 3);
+    BOOST_CHECK_EQUAL(reader->refresh().size(), 1);
+    BOOST_REQUIRE_NO_THROW(reader->begin());
+    BOOST_REQUIRE_NO_THROW(reader->add_import_service(service));
+    BOOST_REQUIRE_NO_THROW(reader->commit());
+
+    remotes.clear();
+    webpier::open_context(dest.string())->get_import_services(remotes);
+
+    BOOST_CHECK_EQUAL(remotes.size(), 3);
+
+    std::string first = "first@mail.box/test";
+    std::string last = "last@mail.box/test";
+
+    BOOST_REQUIRE_NO_THROW(reader->begin());
+    BOOST_REQUIRE_NO_THROW(reader->del_pier(peer));
+    BOOST_REQUIRE_NO_THROW(reader->add_pier(first, peer_certificate));
+    BOOST_REQUIRE_NO_THROW(reader->add_pier(last, peer_certificate));
+
+    // the folder of the last pier can't be created, so the commit fails after the first pier is placed
+    std::ofstream(hrep / "last@mail.box").close();
+
+    BOOST_REQUIRE_THROW(reader->commit(), webpier::file_error);
+    BOOST_CHECK(!std::filesystem::exists(hrep / "first@mail.box"));
+    BOOST_CHECK(std::filesystem::exists(hrep / peer / "cert.crt"));
+    BOOST_CHECK_EQUAL(reader->get_certificate(peer), peer_certificate);
+
+    auto restored = webpier::open_context(dest.string());
+
+    remotes.clear();
+    restored->get_import_services(remotes);
+
+    BOOST_CHECK_EQUAL(remotes.size(), 3);
+    BOOST_CHECK_EQUAL(restored->get_certificate(peer), peer_certificate);
+    BOOST_CHECK_THROW(restored->get_certificate(first), std::exception);
+
+    locals.clear();
+    reader->get_export_services(locals);
+
+    service.name = "garply";
+    BOOST_REQUIRE_NO_THROW(restored->add_import_service(service));
+
+    // the rejected changes are dropped at once, so the refresh of the changed piers only doesn't bring them back
+    webpier::service waldo = service;
+    waldo.name = "waldo";
+    waldo.local = true;
+
+    BOOST_REQUIRE_THROW(reader->add_export_service(waldo), webpier::stale_error);
+    BOOST_REQUIRE_THROW(reader->del_pier(peer), webpier::stale_error);
+    BOOST_CHECK_EQUAL(reader->refresh().size(), 1);
+
+    std::vector<webpier::service> exports;
+    reader->get_export_services(exports);
+
+    BOOST_CHECK_EQUAL(exports.size(), locals.size());
+    BOOST_CHECK(std::none_of(exports.begin(), exports.end(), [](const webpier::service& item) { return item.name == "waldo"; }));
+
+    remotes.clear();
+    reader->get_import_services(remotes);
+
+    BOOST_CHECK_EQUAL(remotes.size(), 4);
 }
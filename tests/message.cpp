@@ -133,3 +133,100 @@ BOOST_AUTO_TEST_CASE(message)
     BOOST_CHECK_EQUAL(replica.payload.index(), initial.payload.index());
     BOOST_CHECK(std::get<std::vector<slipway::report>>(replica.payload) == std::get<std::vector<slipway::report>>(initial.payload));
 }
+
+BOOST_AUTO_TEST_CASE(binary)
+{
+    slipway::handle ident { 
+        "someone@mail.box/pier",
+        "service" 
+        };
+    slipway::health state { 
+        ident,
+        slipway::health::broken,
+        "error"
+        };
+    slipway::report report {
+        state,
+        {
+            { "someone@mail.box/pier", 1 },
+            { "someoneelse@mail.box/pier", 2 }
+        }
+    };
+
+    std::vector<slipway::message> messages {
+        slipway::message::make(slipway::message::naught),
+        slipway::message::make(slipway::message::engage, "error"),
+        slipway::message::make(slipway::message::unplug, ident),
+        slipway::message::make(slipway::message::status, state),
+        slipway::message::make(slipway::message::review, report),
+        slipway::message::make(slipway::message::status, std::vector<slipway::health>{ state, state }),
+        slipway::message::make(slipway::message::review, std::vector<slipway::report>{ report, report }),
+        slipway::message::make(slipway::message::accord, slipway::message_version),
+        slipway::message::make(slipway::message::engage, std::vector<slipway::handle>{ ident, { "someone@mail.box/pier", "" } }),
+        slipway::message::make(slipway::message::status, slipway::query { "someone@mail.box/pier", slipway::query::imports, 1 << slipway::health::broken, slipway::query::state, ident, 100, 0x1234567890abcdef }),
+        slipway::message::make(slipway::message::review, slipway::digest { 0x1234567890abcdef, true, true, slipway::query::state | slipway::query::message | slipway::query::tunnels, { report, report } }),
+        slipway::message::make(slipway::message::status, slipway::digest { 0x1234567890abcdef, true, false, slipway::query::state, { slipway::report { slipway::health { ident, slipway::health::broken, "" }, {} } } }),
+        slipway::message::make(slipway::message::status, slipway::digest { 1, false, false, slipway::query::state | slipway::query::message, {} })
+    };
+
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        auto& initial = messages[i];
+        initial.id = static_cast<uint32_t>(i);
+
+        for (auto format : { slipway::json, slipway::binary })
+        {
+            boost::asio::streambuf buffer;
+            slipway::message replica;
+
+            BOOST_REQUIRE_NO_THROW(slipway::push_message(buffer, initial, format));
+
+            auto match = slipway::frame(format)(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_end(buffer.data()));
+            BOOST_CHECK(match.second);
+            BOOST_CHECK(match.first == boost::asio::buffers_end(buffer.data()));
+
+            match = slipway::frame(format)(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_end(buffer.data()) - 1);
+            BOOST_CHECK(!match.second);
+
+            BOOST_REQUIRE_NO_THROW(slipway::pull_message(buffer, replica, format));
+            BOOST_CHECK_EQUAL(buffer.size(), 0);
+            BOOST_CHECK_EQUAL(replica.action, initial.action);
+            BOOST_CHECK_EQUAL(replica.id, initial.id);
+            BOOST_CHECK(replica.payload == initial.payload);
+        }
+    }
+
+    for (auto format : { slipway::json, slipway::binary })
+    {
+        boost::asio::streambuf buffer;
+
+        for (const auto& initial : messages)
+            BOOST_REQUIRE_NO_THROW(slipway::push_message(buffer, initial, format));
+
+        for (const auto& initial : messages)
+        {
+            slipway::message replica;
+            BOOST_REQUIRE_NO_THROW(slipway::pull_message(buffer, replica, format));
+            BOOST_CHECK_EQUAL(replica.id, initial.id);
+            BOOST_CHECK(replica.payload == initial.payload);
+        }
+
+        BOOST_CHECK_EQUAL(buffer.size(), 0);
+    }
+
+    boost::asio::streambuf buffer;
+    slipway::message replica;
+
+    std::ostream stream(&buffer);
+    stream << std::string("\xff\xff\xff\xff", 4);
+
+    BOOST_REQUIRE_THROW(slipway::pull_message(buffer, replica, slipway::binary), slipway::pipe_error);
+
+    auto large = slipway::message::make(slipway::message::naught, std::string(slipway::max_message_size, 'x'));
+    for (auto format : { slipway::json, slipway::binary })
+    {
+        boost::asio::streambuf output;
+        BOOST_REQUIRE_THROW(slipway::push_message(output, large, format), slipway::pipe_error);
+        BOOST_CHECK_EQUAL(output.size(), 0);
+    }
+}
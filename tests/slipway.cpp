@@ -4,7 +4,9 @@
 #include <boost/test/unit_test.hpp>
 #include <backend/server.h>
 #include <backend/client.h>
+#include <backend/ipc.h>
 #include <future>
+#include <thread>
 #include <store/context.h>
 #include <store/utils.h>
 
@@ -92,6 +94,33 @@ BOOST_AUTO_TEST_CASE(client)
     BOOST_REQUIRE_EQUAL(result.size(), 1);
     BOOST_CHECK(result[0] == bar_active);
 
+    slipway::query filter;
+    slipway::digest digest;
+    BOOST_REQUIRE_NO_THROW(client->status(filter, digest));
+
+    filter.since = digest.stamp;
+    BOOST_REQUIRE_NO_THROW(context->add_export_service(foo));
+
+    // the service is booted by the backend itself once it notices the change of the context, so wait for a new snapshot with it
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        BOOST_REQUIRE_NO_THROW(client->status(filter, digest));
+        if (digest.changed)
+        {
+            filter.since = digest.stamp;
+            if (digest.items.size() == 2)
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    BOOST_REQUIRE_EQUAL(digest.items.size(), 2);
+    BOOST_REQUIRE_NO_THROW(client->status(result));
+    BOOST_REQUIRE_EQUAL(result.size(), 2);
+    BOOST_CHECK(result[0] == bar_active);
+    BOOST_CHECK(result[1] == foo_active);
+
     BOOST_REQUIRE_NO_THROW(client.reset());
     BOOST_REQUIRE_NO_THROW(server->cancel());
 
@@ -100,3 +129,102 @@ BOOST_AUTO_TEST_CASE(client)
 
     BOOST_REQUIRE_NO_THROW(server.reset());
 }
+
+BOOST_AUTO_TEST_CASE(accord)
+{
+    auto home = std::filesystem::current_path() / boost::filesystem::unique_path().string();
+
+    BOOST_SCOPE_EXIT(&home)
+    {
+        std::filesystem::remove_all(home);
+    }
+    BOOST_SCOPE_EXIT_END
+
+    BOOST_REQUIRE_NO_THROW(std::filesystem::create_directory(home));
+
+    boost::asio::io_context io;
+    slipway::ipc::acceptor acceptor(io, slipway::ipc::protocol());
+    acceptor.bind(slipway::ipc::make_endpoint(home));
+    acceptor.listen();
+
+    auto job = std::async(std::launch::async, [&acceptor]()
+    {
+        auto socket = acceptor.accept();
+
+        char buffer[64];
+        boost::system::error_code ec;
+        socket.read_some(boost::asio::buffer(buffer), ec);
+        socket.close(ec);
+    });
+
+    BOOST_REQUIRE_THROW(slipway::connect_backend(home), slipway::pipe_error);
+    BOOST_REQUIRE_EQUAL((int)job.wait_for(std::chrono::seconds(3)), (int)std::future_status::ready);
+}
+
+BOOST_AUTO_TEST_CASE(legacy)
+{
+    auto home = std::filesystem::current_path() / boost::filesystem::unique_path().string();
+
+    BOOST_SCOPE_EXIT(&home)
+    {
+        std::filesystem::remove_all(home);
+    }
+    BOOST_SCOPE_EXIT_END
+
+    BOOST_REQUIRE_NO_THROW(std::filesystem::create_directory(home));
+
+    boost::asio::io_context io;
+    slipway::ipc::acceptor acceptor(io, slipway::ipc::protocol());
+    acceptor.bind(slipway::ipc::make_endpoint(home));
+    acceptor.listen();
+
+    auto job = std::async(std::launch::async, [&acceptor]()
+    {
+        auto socket = acceptor.accept();
+
+        boost::asio::streambuf input;
+        input.consume(boost::asio::read_until(socket, input, '\n'));
+
+        boost::asio::streambuf output;
+        slipway::push_message(output, slipway::message::make(slipway::message::naught, std::string("unknown command")));
+        boost::asio::write(socket, output);
+
+        // nothing else is expected until the client is closed
+        boost::system::error_code ec;
+        boost::asio::read_until(socket, input, '\n', ec);
+        return ec == boost::asio::error::eof;
+    });
+
+    auto client = slipway::connect_backend(home);
+
+    std::vector<slipway::health> result;
+    BOOST_REQUIRE_THROW(client->unplug({ slipway::handle { "pier", "foo" }, slipway::handle { "pier", "bar" } }, result), slipway::task_error);
+    BOOST_REQUIRE_THROW(client->engage({ slipway::handle { "pier", "" } }, result), slipway::task_error);
+
+    slipway::digest digest;
+    BOOST_REQUIRE_THROW(client->status(slipway::query(), digest), slipway::task_error);
+
+    std::promise<std::string> promise;
+    auto future = promise.get_future();
+
+    client->submit(slipway::message::make(slipway::message::status, slipway::query()), std::chrono::seconds(1), [&](const slipway::message& response, const std::string& error)
+    {
+        try
+        {
+            std::vector<slipway::health> list;
+            client->status(list);
+            promise.set_value("");
+        }
+        catch (const slipway::task_error& ex)
+        {
+            promise.set_value(ex.what());
+        }
+    });
+
+    BOOST_REQUIRE_EQUAL((int)future.wait_for(std::chrono::seconds(3)), (int)std::future_status::ready);
+    BOOST_CHECK_EQUAL(future.get(), "The blocking request can't be made from the client callback");
+
+    BOOST_REQUIRE_NO_THROW(client.reset());
+    BOOST_REQUIRE_EQUAL((int)job.wait_for(std::chrono::seconds(3)), (int)std::future_status::ready);
+    BOOST_CHECK(job.get());
+}
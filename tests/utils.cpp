@@ -2,11 +2,17 @@
 
 #include <store/utils.h>
 #include <boost/test/unit_test.hpp>
+#include <openssl/ssl.h>
 #include <boost/scope_exit.hpp>
 #include <boost/filesystem.hpp>
 #include <filesystem>
 #include <fstream>
 
+#ifdef __unix__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 BOOST_AUTO_TEST_CASE(x509)
 {
     auto dest = std::filesystem::current_path() / boost::filesystem::unique_path().string();
@@ -34,3 +40,53 @@ BOOST_AUTO_TEST_CASE(x509)
     BOOST_REQUIRE_NO_THROW(BOOST_CHECK_EQUAL(webpier::get_x509_public_sha1(cert), webpier::get_x509_public_sha1(copy)));
     BOOST_REQUIRE_NO_THROW(BOOST_CHECK_EQUAL(webpier::load_x509_cert(cert), webpier::load_x509_cert(copy)));
 }
+
+#if defined(SSL_OP_ENABLE_KTLS) && defined(__unix__)
+BOOST_AUTO_TEST_CASE(ktls)
+{
+    auto conf = std::filesystem::current_path() / boost::filesystem::unique_path().string();
+
+    BOOST_SCOPE_EXIT(&conf) 
+    {
+        std::filesystem::remove(conf);
+    } 
+    BOOST_SCOPE_EXIT_END
+
+    std::ofstream(conf) << "openssl_conf = init\n[init]\nssl_conf = ssl\n[ssl]\nsystem_default = tls\n[tls]\nMinProtocol = TLSv1.2\nOptions = NoRenegotiation\n";
+
+    // the global config of the OpenSSL is changed in the child process to keep it for the other tests
+    auto pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+
+    if (pid == 0)
+    {
+        setenv("OPENSSL_CONF", conf.c_str(), 1);
+
+        try
+        {
+            webpier::enable_kernel_tls();
+        }
+        catch (const std::exception&)
+        {
+            _exit(1);
+        }
+
+        std::unique_ptr<SSL_CTX, void (*)(SSL_CTX*)> ctx(SSL_CTX_new(TLS_method()), SSL_CTX_free);
+        if (!ctx)
+            _exit(2);
+
+        if ((SSL_CTX_get_options(ctx.get()) & SSL_OP_ENABLE_KTLS) == 0)
+            _exit(3);
+
+        if ((SSL_CTX_get_options(ctx.get()) & SSL_OP_NO_RENEGOTIATION) == 0 || SSL_CTX_get_min_proto_version(ctx.get()) != TLS1_2_VERSION)
+            _exit(4);
+
+        _exit(0);
+    }
+
+    int status = 0;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_REQUIRE(WIFEXITED(status));
+    BOOST_CHECK_EQUAL(WEXITSTATUS(status), 0);
+}
+#endif